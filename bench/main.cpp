@@ -0,0 +1,361 @@
+#include "ComputerCard.h"
+#include "FdnReverb.h"
+#include "pico/stdlib.h"
+#include "hardware/structs/systick.h"
+#include "hardware/sync.h"
+#include <cstdio>
+
+/**
+Framework benchmarks for the Workshop System Computer
+
+Times DSP building blocks in CPU cycles using SysTick, and prints the
+results over USB serial every few seconds. Run code is placed in RAM,
+as it is for the audio interrupt, and interrupts are disabled while
+timing so that USB servicing doesn't disturb the counts.
+*/
+
+static const int NUM_CALLS = 4096;
+
+// Pseudo-random delay lengths (samples, Q7) and fractions used by the read benchmarks
+static int32_t testDelays[NUM_CALLS];
+static volatile int32_t sink;
+
+// SysTick as a free-running 24-bit down-counter at the system clock
+static void StartCycleCounter()
+{
+    systick_hw->rvr = 0x00FFFFFF;
+    systick_hw->cvr = 0;
+    systick_hw->csr = 0x5; // enable, processor clock, no interrupt
+}
+
+// Total cycles for NUM_CALLS calls of fn
+template <typename Fn>
+static uint32_t __not_in_flash_func(TimeCalls)(Fn fn)
+{
+    uint32_t irq = save_and_disable_interrupts();
+    uint32_t start = systick_hw->cvr;
+    for (int i = 0; i < NUM_CALLS; i++) {
+        sink = fn(i);
+    }
+    uint32_t end = systick_hw->cvr;
+    restore_interrupts(irq);
+    return (start - end) & 0x00FFFFFF;
+}
+
+static uint32_t loopOverhead;
+
+template <typename Fn>
+static void Report(const char *name, Fn fn)
+{
+    uint32_t cycles = TimeCalls(fn) - loopOverhead;
+    printf("%-52s %7.2f\n", name, (float)cycles / NUM_CALLS);
+}
+
+
+////////////////////////////////////////
+// Delay line reads
+
+// Delay line read as the cards did before InterpDelayLine:
+// wrap with %, linear interpolation with two multiplies (7-bit fraction)
+template <int Size>
+static int32_t __not_in_flash_func(ModuloRead)(const int16_t *buffer, int32_t writeIndex, int32_t delayFine)
+{
+    int32_t delay = delayFine >> 7;
+    int32_t fraction = delayFine & 0x7F;
+
+    int32_t readIndex1 = writeIndex - delay - 1;
+    int32_t readIndex2 = writeIndex - delay - 2;
+    if (readIndex1 < 0) readIndex1 += Size;
+    if (readIndex2 < 0) readIndex2 += Size;
+    readIndex1 = readIndex1 % Size;
+    readIndex2 = readIndex2 % Size;
+
+    int32_t sample1 = buffer[readIndex1];
+    int32_t sample2 = buffer[readIndex2];
+    return (sample2 * fraction + sample1 * (128 - fraction) + 64) >> 7;
+}
+
+// String read as the resonator did before InterpDelayLine:
+// wrap with compares, linear interpolation with two multiplies (8-bit fraction)
+template <int Size>
+static int32_t __not_in_flash_func(CompareRead)(const int16_t *buffer, int32_t writeIndex, int32_t delayLength, int32_t frac)
+{
+    int readIndex1 = writeIndex - delayLength;
+    if (readIndex1 < 0) readIndex1 += Size;
+    int readIndex2 = readIndex1 - 1;
+    if (readIndex2 < 0) readIndex2 += Size;
+
+    int32_t sample1 = buffer[readIndex1];
+    int32_t sample2 = buffer[readIndex2];
+    return ((sample1 * (256 - frac)) + (sample2 * frac)) >> 8;
+}
+
+static const int LONG_SIZE = 48000;
+static const int STRING_SIZE = 1920;
+
+static int16_t longBuffer[LONG_SIZE];
+static int16_t stringBuffer[STRING_SIZE];
+static InterpDelayLine<LONG_SIZE> longLine;
+static InterpDelayLine<STRING_SIZE> stringLine;
+static InterpDelayLine<2048> pow2Line;
+
+static void DelayLineReads()
+{
+    printf("\nDelay line reads (cycles per read)\n");
+
+    Report("% wrap + multiply blend, 48000 samples", [](int i) {
+        return ModuloRead<LONG_SIZE>(longBuffer, i, testDelays[i]);
+    });
+    Report("InterpDelayLine<48000>::ReadAt", [](int i) {
+        return longLine.ReadAt(i - (testDelays[i] >> 7) - 1, (testDelays[i] & 0x7F) << 1);
+    });
+    Report("compare wrap + multiply blend, 1920 samples", [](int i) {
+        return CompareRead<STRING_SIZE>(stringBuffer, i & 1023, (testDelays[i] >> 7) & 1023, testDelays[i] & 0xFF);
+    });
+    Report("InterpDelayLine<1920>::Read", [](int i) {
+        return stringLine.Read((testDelays[i] >> 7) & 1023, testDelays[i] & 0xFF);
+    });
+    Report("InterpDelayLine<2048>::Read (masked wrap)", [](int i) {
+        return pow2Line.Read((testDelays[i] >> 7) & 1023, testDelays[i] & 0xFF);
+    });
+}
+
+
+////////////////////////////////////////
+// Allpass diffusion
+
+// AudioDelay's DIFFUSE chain (four prime-length stages) and a single stage, to
+// show the cost per stage
+static const int32_t oneStageLength[1] = {409};
+static const int32_t fourStageLengths[4] = {113, 241, 409, 659};
+static int16_t allpassStorage[113 + 241 + 409 + 659];
+static AllpassChain<1> oneStage(allpassStorage, oneStageLength, 2560);
+static AllpassChain<4> fourStages(allpassStorage, fourStageLengths, 2560);
+
+static void AllpassDiffusion()
+{
+    printf("\nAllpass diffusion (cycles per sample)\n");
+
+    Report("AllpassChain<1>::Process", [](int i) {
+        return oneStage.Process((testDelays[i] & 0xFFF) - 2048);
+    });
+    Report("AllpassChain<4>::Process", [](int i) {
+        return fourStages.Process((testDelays[i] & 0xFFF) - 2048);
+    });
+}
+
+
+////////////////////////////////////////
+// Delay control path
+
+// AudioDelay's per-sample control math as it was, with 64-bit multiplies
+// (library calls on the Cortex-M0+), and as it is, in 32 bits.
+// delayFine is a delay time in samples, Q7; all return the same results.
+
+static int32_t __not_in_flash_func(Smooth64)(int32_t smoothed, int32_t target)
+{
+    return (int32_t)(((int64_t)smoothed * 255 + target + 128) >> 8);
+}
+
+static int32_t __not_in_flash_func(Smooth32)(int32_t smoothed, int32_t target)
+{
+    return smoothed + ((target - smoothed + 128) >> 8);
+}
+
+static int32_t __not_in_flash_func(Shimmer64)(int32_t delayFine)
+{
+    int64_t temp = (int64_t)delayFine * -21782;
+    return (int32_t)((temp + (temp >= 0 ? 32768 : -32768)) >> 16);
+}
+
+static int32_t __not_in_flash_func(Shimmer32)(int32_t delayFine)
+{
+    int32_t high = (delayFine >> 8) * -21782;
+    int32_t low = (delayFine & 0xFF) * -21782;
+    int32_t rounding = (delayFine > 0) ? -32768 : 32768;
+    return (high + ((low + rounding) >> 8)) >> 8;
+}
+
+static int32_t __not_in_flash_func(StereoOffset64)(int32_t delayFine)
+{
+    return (int32_t)(((int64_t)delayFine * 110) / 100);
+}
+
+static int32_t __not_in_flash_func(StereoOffset32)(int32_t delayFine)
+{
+    return delayFine + delayFine / 10;
+}
+
+// warmSaturate's drive and output scaling, and the saturation mode's dynamic gain
+static int32_t __not_in_flash_func(Saturate64)(int32_t input)
+{
+    int64_t driven = ((int64_t)input * 2725 + 1024) >> 11;
+    int32_t output = (int32_t)(((int64_t)driven * 1434 + 1024) >> 11);
+    return (int32_t)(((int64_t)output * 2340 + 1024) >> 11);
+}
+
+static int32_t __not_in_flash_func(Saturate32)(int32_t input)
+{
+    int32_t driven = (input * 2725 + 1024) >> 11;
+    int32_t output = (driven * 1434 + 1024) >> 11;
+    return (output * 2340 + 1024) >> 11;
+}
+
+static void DelayControlPath()
+{
+    printf("\nDelay control path, 64-bit vs 32-bit (cycles per call)\n");
+
+    Report("delay time smoothing, 64-bit", [](int i) {
+        return Smooth64(testDelays[i], testDelays[(i + 1) & (NUM_CALLS - 1)]);
+    });
+    Report("delay time smoothing, 32-bit", [](int i) {
+        return Smooth32(testDelays[i], testDelays[(i + 1) & (NUM_CALLS - 1)]);
+    });
+    Report("shimmer pitch offset, 64-bit", [](int i) {
+        return Shimmer64(testDelays[i]);
+    });
+    Report("shimmer pitch offset, 32-bit", [](int i) {
+        return Shimmer32(testDelays[i]);
+    });
+    Report("stereo offset (* 110 / 100), 64-bit", [](int i) {
+        return StereoOffset64(testDelays[i]);
+    });
+    Report("stereo offset (x + x / 10), 32-bit", [](int i) {
+        return StereoOffset32(testDelays[i]);
+    });
+    Report("saturation gains, 64-bit", [](int i) {
+        return Saturate64((testDelays[i] & 0xFFF) - 2048);
+    });
+    Report("saturation gains, 32-bit", [](int i) {
+        return Saturate32((testDelays[i] & 0xFFF) - 2048);
+    });
+}
+
+
+////////////////////////////////////////
+// ProcessSample dispatch
+
+// A small card DSP (delay line with filtered feedback), shared by a card that
+// is called through the vtable, as ComputerCard does, and one called statically,
+// as ComputerCardT does
+template <class Base>
+class DispatchBenchCard : public Base
+{
+public:
+    void __not_in_flash_func(ProcessSample)() override
+    {
+        int32_t in = this->AudioIn1();
+        int32_t delayed = line.Read(1000, 100);
+        lowpass += ((delayed - lowpass) * 30000 + 32768) >> 16;
+        line.Write((int16_t)(in + ((lowpass * 3) >> 2)));
+        line.Advance();
+        this->AudioOut1((int16_t)delayed);
+    }
+
+private:
+    int32_t lowpass = 0;
+    InterpDelayLine<1024> line;
+};
+
+class VirtualBenchBase : public ComputerCard
+{
+public:
+    virtual void ProcessSample() override = 0;
+};
+
+class VirtualBenchCard : public DispatchBenchCard<VirtualBenchBase> {};
+class StaticBenchCard : public DispatchBenchCard<ComputerCardT<StaticBenchCard>> {};
+
+static void ProcessSampleDispatch()
+{
+    static VirtualBenchCard virtualCard;
+    static StaticBenchCard staticCard;
+    static VirtualBenchBase *volatile virtualPtr = &virtualCard;
+
+    printf("\nProcessSample dispatch (cycles per sample)\n");
+
+    Report("ComputerCard, virtual ProcessSample", [](int) {
+        virtualPtr->ProcessSample();
+        return 0;
+    });
+    Report("ComputerCardT, static ProcessSample", [](int) {
+        staticCard.StaticBenchCard::ProcessSample();
+        return 0;
+    });
+}
+
+
+////////////////////////////////////////
+// Reverb card
+
+// A whole sample of FdnReverb, run through ReplaySample with noise at its
+// inputs, against ReplaySample of a card that does nothing: the difference is
+// the reverb's ProcessSample
+class EmptyBenchCard : public ComputerCardT<EmptyBenchCard>
+{
+    friend ComputerCardT;
+
+protected:
+    void ProcessSample() {}
+};
+
+static void ReverbCard()
+{
+    static FdnReverb reverb;
+    static EmptyBenchCard emptyCard;
+    static ComputerCard::TraceInputs inputs;
+    static int16_t audioOut[2];
+    static int32_t cvOut[2];
+
+    inputs.knobs[ComputerCard::Main] = 2048;
+    inputs.knobs[ComputerCard::X] = 3000;
+    inputs.knobs[ComputerCard::Y] = 1000;
+    for (int i = 0; i < 6; i++) inputs.connected[i] = (i < 2);
+    inputs.switchVal = ComputerCard::Middle;
+    inputs.quality = ComputerCard::Full;
+
+    printf("\nReverb card (cycles per sample)\n");
+
+    Report("ReplaySample, empty card", [](int i) {
+        inputs.audio[0] = inputs.audio[1] = (int16_t)((testDelays[i] & 0xFFF) - 2048);
+        emptyCard.ReplaySample(inputs, audioOut, cvOut);
+        return audioOut[0];
+    });
+    Report("ReplaySample, FdnReverb", [](int i) {
+        inputs.audio[0] = inputs.audio[1] = (int16_t)((testDelays[i] & 0xFFF) - 2048);
+        reverb.ReplaySample(inputs, audioOut, cvOut);
+        return audioOut[0];
+    });
+}
+
+
+int main()
+{
+    stdio_init_all();
+    ComputerCard::ConfigureInterpolators();
+    ComputerCard::PaintStack();
+    StartCycleCounter();
+
+    uint32_t lcg = 1;
+    for (int i = 0; i < NUM_CALLS; i++) {
+        lcg = 1664525 * lcg + 1013904223;
+        testDelays[i] = (lcg >> 8) % ((LONG_SIZE - 2) << 7);
+    }
+    for (int i = 0; i < LONG_SIZE; i++) {
+        longBuffer[i] = (int16_t)((i * 37) & 0xFFF) - 2048;
+    }
+
+    loopOverhead = TimeCalls([](int i) { return testDelays[i]; });
+
+    while (true) {
+        sleep_ms(3000);
+        printf("\n=== Workshop System benchmarks (%d calls each, loop overhead removed) ===\n", NUM_CALLS);
+        DelayLineReads();
+        AllpassDiffusion();
+        DelayControlPath();
+        ProcessSampleDispatch();
+        ReverbCard();
+        printf("\nStack high water: %lu bytes\n", (unsigned long)ComputerCard::StackHighWater());
+    }
+    return 0;
+}
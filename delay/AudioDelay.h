@@ -0,0 +1,877 @@
+#ifndef AUDIODELAY_H
+#define AUDIODELAY_H
+
+#include "ComputerCard.h"
+
+// Audio delay for Music Thing Modular Workshop System
+class AudioDelay : public ComputerCardT<AudioDelay>
+{
+    friend ComputerCardT;
+
+private:
+    // Fixed-point formats: 12-bit samples, gains on the 0-4095 scale, and
+    // delay times in samples with 7 fractional bits
+    using Sample = Fixed<11, 0>;
+    using Gain = Fixed<0, 12>;
+    using DelayTime = Fixed<17, 7>;
+
+    // Delay buffer parameters
+    static const int MAX_DELAY_SIZE = 96000;  // 2.0 seconds at 48kHz
+
+    // DIFFUSE mode: allpasses on what goes into the delay line, so each repeat is
+    // smeared further than the last. Their lines are spare samples at the end of
+    // the delay buffer, with prime lengths from about 2ms to 14ms.
+    static constexpr int32_t diffuserLengths[4] = {
+        TableMath::NextPrime(110), TableMath::NextPrime(240), TableMath::NextPrime(408), TableMath::NextPrime(658)
+    };
+    static constexpr int32_t DIFFUSER_SAMPLES = AllpassChain<4>::StorageSize(diffuserLengths);
+    static const int32_t DIFFUSION = 2560;  // allpass gain, 0.625
+
+    InterpDelayLine<MAX_DELAY_SIZE, DIFFUSER_SAMPLES> delayLine;
+    AllpassChain<4> diffuser;
+    int32_t bufferHistory;  // samples of audio in delayLine, up to its size; the looper packs it otherwise
+
+    // Control smoothing
+    int32_t smoothedDelay;
+    int32_t lastRawControl;  // For hysteresis
+    int32_t ledCounter;
+
+    // Mode selection: four echo modes, three modulation modes, the looper, beat
+    // repeat, and a fifth echo mode
+    enum DelayMode { CLEAN = 0, SATURATION = 1, SHIMMER = 2, LOFI = 3,
+                     CHORUS = 4, FLANGER = 5, VIBRATO = 6, LOOPER = 7, REPEAT = 8, DIFFUSE = 9, NUM_MODES = 10 };
+    DelayMode currentMode;
+    bool lastSwitchDown;
+
+    // Modulation modes: a short delay swept by an LFO, in a region carved from
+    // the start of the delay buffer, which the echo path leaves alone in these
+    // modes. The sweep moves a fraction of a sample at a time, so reads take a
+    // 16-bit fraction. X sets the rate and Y the depth.
+    struct ModShape {
+        int32_t centre;       // delay, samples
+        int32_t maxSwing;     // either side of the centre at full depth, samples
+        int32_t feedback;     // 0-4095
+        bool triangle;        // otherwise sine
+        uint32_t rightPhase;  // LFO phase offset of the right channel
+    };
+    static constexpr ModShape modShapes[3] = {
+        {576, 288, 0, false, 1u << 30},  // CHORUS: 6-18ms, right channel in quadrature
+        {150, 140, 2458, true, 0},       // FLANGER: 0.2-6ms, 60% feedback
+        {288, 240, 0, false, 0},         // VIBRATO: 1-11ms
+    };
+    static const int MOD_REGION_SIZE = 2048;  // 43ms
+    DelayRegion<MOD_REGION_SIZE> modLine;
+    int32_t modFilled;  // samples written since entering a modulation mode
+    int32_t modSwing;   // smoothed depth, samples Q8
+    Lfo lfo;
+    static const int LFO_RATE_STEPS = 256;
+    static constexpr auto lfoRates = MakeTable<uint32_t, LFO_RATE_STEPS>([](int i) {
+        return Lfo::Increment(0.05 * TableMath::Exp2(i * 7.32 / (LFO_RATE_STEPS - 1)));  // 0.05Hz to 8Hz
+    });
+
+    // Looper: the delay buffer as 8-bit companded samples, two per 16-bit slot,
+    // so it holds 4 seconds. Pulse In 1 starts recording, stops it (closing the
+    // loop), then turns overdub on and off; Pulse In 2 clears the loop. The loop
+    // length is timed from the edges' timestamps. Before recording, input is kept
+    // running in the buffer, so that recording starts at the edge's sample, and
+    // after it, LOOP_FADE samples more are recorded and crossfaded into the
+    // start, so the loop plays through its end seamlessly.
+    enum LoopState { LOOP_EMPTY, LOOP_RECORDING, LOOP_CLOSING, LOOP_PLAYING };
+    static const int32_t LOOP_CAPACITY = 2 * MAX_DELAY_SIZE;
+    static const int32_t LOOP_FADE = 256;
+    static const int32_t LOOP_MIN_LENGTH = 4800;  // 100ms
+    static const int32_t LOOP_MAX_LENGTH = LOOP_CAPACITY - LOOP_FADE;
+    static const int32_t LOOP_PULSE_SAMPLES = 480;  // Pulse Out 1 high for 10ms per loop
+    uint8_t *loopBuffer;
+    LoopState loopState;
+    int32_t loopHead;       // write position while empty, physical
+    int32_t loopHeld;       // samples of input held while empty, up to LOOP_CAPACITY
+    int32_t loopStart;      // physical position of the loop's first sample
+    int32_t loopLength;
+    int32_t loopPos;        // position in the loop (while recording, samples recorded)
+    uint32_t loopStartTime; // microseconds, of the edge that started recording
+    int32_t loopFaded;      // samples of the start crossfaded so far
+    bool overdubbing;
+    int32_t overdubLevel;   // 0-4095, ramped so that punching in and out doesn't click
+
+    // Beat repeat: while Pulse In 2 is high, slices of the audio just before it
+    // went high are played over and over, read from delayLine in place. A slice
+    // is a fraction of the tap tempo interval (X knob), timed in Q7 samples, so
+    // slice boundaries land on the right sample however long the run. Each clock
+    // (tap) on Pulse In 1 starts a new slice, to stay in time. The Y knob picks
+    // forward, reverse or an octave down, and within each, the decay per slice.
+    // At each new slice the previous one plays on, fading out over REPEAT_FADE
+    // samples: the only time two reads are made.
+    enum RepeatStyle { FORWARD, REVERSE, OCTAVE_DOWN };
+    static const int REPEAT_DIVISIONS = 6;  // 2 beats, 1, 1/2, 1/4, 1/8, 1/16
+    static const int32_t REPEAT_FADE = 128;
+    static const int32_t REPEAT_MAX_SLICE = MAX_DELAY_SIZE / 2;
+    bool repeating;
+    bool lastRepeatGate;
+    int32_t repeatLevel;       // 0-4095, from the input to the repeats
+    int32_t captureIndex;      // write position when the repeat started
+    int32_t captureWritten;    // samples written since, up to REPEAT_FADE
+    int32_t sliceLength;       // samples
+    int32_t slicePosFine;      // position in the slice, Q7
+    int32_t sliceGain;         // 0-4095
+    RepeatStyle lastRepeatStyle;
+    int32_t fadeCapture;       // the previous slice, as it ended
+    RepeatStyle fadeStyle;
+    int32_t fadeLength;
+    int32_t fadePos;
+    int32_t fadeGain;
+    int32_t fadeCount;         // samples of fade left
+
+    // Dry/wet mix (Main knob). After setting the tone, the mix holds until the
+    // knob comes back to it.
+    EqualPowerMixer mixer;
+    int32_t mixSetting;
+    bool mixLive;
+    static const int32_t PICKUP_RANGE = 48;
+
+    // Tone of the repeats (switch up + Main knob): below the centre a lowpass,
+    // from 7kHz down to 500Hz; above it a highpass, from 40Hz up to 1.3kHz.
+    // Filter coefficients are looked up when the setting changes.
+    enum ToneType { DARK, FLAT, THIN };
+    static const int TONE_STEPS = 64;
+    static const int32_t TONE_FLAT_LOW = 1792;   // flat between these settings
+    static const int32_t TONE_FLAT_HIGH = 2304;
+    static constexpr auto darkCutoffs = MakeTable<int32_t, TONE_STEPS + 1>([](int i) {
+        return StateVariableFilter::Coefficient(7000 / TableMath::Exp2(i * 3.8 / TONE_STEPS));
+    });
+    static constexpr auto thinCutoffs = MakeTable<int32_t, TONE_STEPS + 1>([](int i) {
+        return StateVariableFilter::Coefficient(40 * TableMath::Exp2(i * 5.0 / TONE_STEPS));
+    });
+    StateVariableFilter toneFilter;
+    ToneType toneType;
+    int32_t toneSetting;
+
+    // Filter states
+    int32_t hpfState;
+    int32_t shimmerHpfState;
+    int32_t saturationAccum;
+
+    // Tap tempo state (Pulse In 1), timed from captured edges to the microsecond
+    uint32_t lastTapTime;      // microseconds
+    int32_t tapIntervalFine;   // samples, Q7
+    uint32_t tapTimeout;
+    bool tapTempoActive;
+    uint32_t sampleCounter;
+
+    // Freeze state
+    bool lastFreezeActive;
+    int32_t frozenWritePos;
+    int32_t frozenDelayTimeL;
+    int32_t frozenDelayTimeR;
+
+    int32_t highpass(int32_t input) {
+        // One-pole highpass filter with coefficient b = 200
+        // *state += (((input - *state) * b) >> 16)
+        // return input - *state
+        hpfState += (((input - hpfState) * 200 + 32768) >> 16);
+        return input - hpfState;
+    }
+
+    int32_t shimmerHighpass(int32_t input) {
+        shimmerHpfState += (((input - shimmerHpfState) * 1200 + 32768) >> 16);
+        return input - shimmerHpfState;
+    }
+
+    void clip(int32_t &a) {
+        if (a < -2047) a = -2047;
+        if (a > 2047) a = 2047;
+    }
+
+    int32_t warmSaturate(int32_t input) {
+        // Progressive saturation - slowly track signal energy with cap
+        int32_t absInput = (input < 0) ? -input : input;
+        saturationAccum = ((252 * saturationAccum + 128) >> 8) + ((absInput + 128) >> 8);
+
+        if (saturationAccum > 400) saturationAccum = 400;
+
+        int32_t drive = 2700 + ((saturationAccum + 8) >> 4);
+
+        // |input| < 2048 and drive < 2726, so products here fit in 32 bits
+        int32_t driven = (input * drive + 1024) >> 11;
+
+        int32_t output;
+
+        const int32_t softKnee = 600;
+
+        if (driven >= 0) {
+            if (driven < softKnee) {
+                output = driven;
+            } else {
+                int32_t excess = driven - softKnee;
+                output = softKnee + ((excess + 4) >> 3) + ((excess + 16) >> 5);  // ~31.25% of excess
+                if (output > 2047) output = 2047;
+            }
+        } else {
+            int32_t posInput = -driven;
+            if (posInput < softKnee) {
+                output = driven;
+            } else {
+                int32_t excess = posInput - softKnee;
+                output = -(softKnee + ((excess + 4) >> 3) + ((excess + 16) >> 5));
+                if (output < -2047) output = -2047;
+            }
+        }
+
+        output = (output * 1434 + 1024) >> 11;
+
+        return output;
+    }
+
+    void setTone(int32_t setting) {
+        if (setting == toneSetting) return;
+        toneSetting = setting;
+
+        ToneType type = FLAT;
+        if (setting < TONE_FLAT_LOW) {
+            type = DARK;
+            toneFilter.SetCutoff(darkCutoffs[(TONE_FLAT_LOW - setting) * TONE_STEPS / TONE_FLAT_LOW]);
+        } else if (setting > TONE_FLAT_HIGH) {
+            type = THIN;
+            toneFilter.SetCutoff(thinCutoffs[(setting - TONE_FLAT_HIGH) * TONE_STEPS / (4095 - TONE_FLAT_HIGH)]);
+        }
+        if (type != toneType) toneFilter.Reset();
+        toneType = type;
+    }
+
+    void processModulation(int32_t audioIn, int32_t &wetLeft, int32_t &wetRight) {
+        const ModShape &shape = modShapes[currentMode - CHORUS];
+
+        int32_t rate = KnobVal(X) + CVIn1();
+        if (rate > 4095) rate = 4095;
+        if (rate < 0) rate = 0;
+        lfo.SetIncrement(lfoRates[rate >> 4]);
+
+        // Depth, smoothed so that turning it doesn't step the delay
+        int32_t depth = KnobVal(Y) + CVIn2();
+        if (depth > 4095) depth = 4095;
+        if (depth < 0) depth = 0;
+        int32_t targetSwing = (shape.maxSwing * depth) >> 4;
+        modSwing += (targetSwing - modSwing + 128) >> 8;
+
+        int32_t lfoLeft = shape.triangle ? lfo.Triangle() : lfo.Sine();
+        int32_t lfoRight = shape.triangle ? lfo.Triangle(shape.rightPhase) : lfo.Sine(shape.rightPhase);
+        lfo.Step();
+
+        // Delays in samples Q16: the LFO (Q14 after the shift) times the swing (Q8)
+        // fits 32 bits. Until the region has filled, they are limited to what has
+        // been written since the mode was entered, so no stale audio is heard.
+        int32_t limit = modFilled << 16;
+        int32_t delayLeft = (shape.centre << 16) + (((lfoLeft >> 1) * modSwing) >> 6);
+        int32_t delayRight = (shape.centre << 16) + (((lfoRight >> 1) * modSwing) >> 6);
+        if (delayLeft > limit) delayLeft = limit;
+        if (delayRight > limit) delayRight = limit;
+
+        int32_t writeIndex = modLine.WriteIndex();
+        wetLeft = modLine.ReadAtFine(writeIndex - (delayLeft >> 16) - 1, delayLeft & 0xFFFF);
+        wetRight = wetLeft;
+        if (shape.rightPhase != 0) {
+            wetRight = modLine.ReadAtFine(writeIndex - (delayRight >> 16) - 1, delayRight & 0xFFFF);
+        }
+
+        int32_t write = audioIn + ((wetLeft * shape.feedback + 2048) >> 12);
+        clip(write);
+        modLine.Write((int16_t)write);
+        modLine.Advance();
+        if (modFilled < MOD_REGION_SIZE) modFilled++;
+    }
+
+    // 12-bit sample to 8 bits: sign, 3-bit segment, 4-bit mantissa, with a step of
+    // 2 below 64 doubling each octave up to 64 at the top
+    static uint8_t encodeLoopSample(int32_t x) {
+        uint8_t sign = 0;
+        if (x < 0) {
+            sign = 0x80;
+            x = -x;
+        }
+        if (x > 2047) x = 2047;
+        int32_t segment = 0;
+        for (int32_t m = x >> 5; m; m >>= 1) segment++;
+        int32_t mantissa = (segment == 0) ? (x >> 1) : ((x >> segment) & 15);
+        return sign | (segment << 4) | mantissa;
+    }
+
+    // Middle of each step, except the lowest segment, so that silence decodes to 0
+    static int32_t decodeLoopSample(uint8_t code) {
+        int32_t segment = (code >> 4) & 7;
+        int32_t mantissa = code & 15;
+        int32_t x = (segment == 0) ? (mantissa << 1) : (((16 + mantissa) << segment) + (1 << (segment - 1)));
+        return (code & 0x80) ? -x : x;
+    }
+
+    int32_t loopIndex(int32_t pos) const {
+        int32_t index = loopStart + pos;
+        if (index >= LOOP_CAPACITY) index -= LOOP_CAPACITY;
+        return index;
+    }
+
+    // Samples between the time of an edge and the start of this sample
+    int32_t samplesSince(uint32_t time) {
+        return (int32_t)(((SampleTime() - time) * 6 + 62) / 125);
+    }
+
+    void clearLoop() {
+        loopState = LOOP_EMPTY;
+        loopHeld = 0;
+        overdubbing = false;
+        overdubLevel = 0;
+    }
+
+    int32_t processLooper(int32_t audioIn) {
+        PulseEdge edges[4];
+        int numEdges = PulseInEdges(0, edges, 4);
+        for (int i = 0; i < numEdges; i++) {
+            if (!edges[i].rising) continue;
+            if (loopState == LOOP_EMPTY) {
+                // Start at the edge's sample, from the input held in the buffer
+                int32_t age = samplesSince(edges[i].time);
+                if (age > loopHeld) age = loopHeld;
+                if (age < 0) age = 0;
+                loopStart = loopHead - age;
+                if (loopStart < 0) loopStart += LOOP_CAPACITY;
+                loopPos = age;
+                loopStartTime = edges[i].time;
+                loopState = LOOP_RECORDING;
+            } else if (loopState == LOOP_RECORDING) {
+                int32_t length = (int32_t)(((edges[i].time - loopStartTime) * 6 + 62) / 125);
+                if (length < LOOP_MIN_LENGTH) length = LOOP_MIN_LENGTH;
+                if (length > LOOP_MAX_LENGTH) length = LOOP_MAX_LENGTH;
+                loopLength = length;
+                loopState = LOOP_CLOSING;
+            } else if (loopState == LOOP_PLAYING) {
+                overdubbing = !overdubbing;
+            }
+        }
+        if (PulseIn2RisingEdge()) clearLoop();
+
+        int32_t wet = 0;
+        switch (loopState) {
+        case LOOP_EMPTY:
+            loopBuffer[loopHead] = encodeLoopSample(audioIn);
+            if (++loopHead == LOOP_CAPACITY) loopHead = 0;
+            if (loopHeld < LOOP_CAPACITY) loopHeld++;
+            break;
+
+        case LOOP_RECORDING:
+        case LOOP_CLOSING:
+            loopBuffer[loopIndex(loopPos)] = encodeLoopSample(audioIn);
+            loopPos++;
+            if (loopState == LOOP_RECORDING && loopPos == LOOP_MAX_LENGTH) {
+                loopLength = LOOP_MAX_LENGTH;
+                loopState = LOOP_CLOSING;
+            }
+            if (loopState == LOOP_CLOSING && loopPos >= loopLength + LOOP_FADE) {
+                // Play on from where the recording has got to
+                loopPos -= loopLength;
+                loopFaded = 0;
+                loopState = LOOP_PLAYING;
+            }
+            break;
+
+        case LOOP_PLAYING: {
+            // Crossfade the start from the audio recorded past the end, one sample
+            // at a time, before playback comes round to it
+            if (loopFaded < LOOP_FADE) {
+                int32_t start = loopIndex(loopFaded);
+                int32_t from = decodeLoopSample(loopBuffer[loopIndex(loopLength + loopFaded)]);
+                int32_t to = decodeLoopSample(loopBuffer[start]);
+                loopBuffer[start] = encodeLoopSample((from * (LOOP_FADE - loopFaded) + to * loopFaded) >> 8);
+                loopFaded++;
+            }
+
+            int32_t index = loopIndex(loopPos);
+            uint8_t code = loopBuffer[index];
+            wet = decodeLoopSample(code);
+
+            // Overdub: add the input, and fade what was there by the Y knob
+            int32_t target = overdubbing ? 4095 : 0;
+            if (overdubLevel < target) overdubLevel += 16;
+            if (overdubLevel > target) overdubLevel -= 16;
+            if (overdubLevel > 4095) overdubLevel = 4095;
+            if (overdubLevel < 0) overdubLevel = 0;
+            if (overdubLevel > 0) {
+                int32_t decay = 4095 - (((4095 - KnobVal(Y)) * overdubLevel + 2048) >> 12);
+                int32_t dub = ((wet * decay + 2048) >> 12) + ((audioIn * overdubLevel + 2048) >> 12);
+                loopBuffer[index] = encodeLoopSample(dub);
+            }
+
+            if (++loopPos == loopLength) loopPos = 0;
+            break;
+        }
+        }
+        return wet;
+    }
+
+    // Slice sample at pos (beyond length for the continuation of a slice that has
+    // ended): from the last length samples before capture, forwards, backwards
+    // from capture, or forwards at half speed
+    int32_t readSlice(int32_t capture, RepeatStyle style, int32_t length, int32_t pos) const {
+        if (style == REVERSE) return delayLine.ReadAt(capture - 1 - pos, 0);
+        if (style == OCTAVE_DOWN) return delayLine.ReadAt(capture - length + ((pos + 1) >> 1), (pos & 1) << 7);
+        return delayLine.ReadAt(capture - length + pos, 0);
+    }
+
+    int32_t processRepeat(int32_t audioIn, bool clockEdge, int32_t clockAge) {
+        // Slice length: a division of the tap interval, and no longer than the
+        // audio written since the buffer last held packed loop samples
+        int32_t division = KnobVal(X) * REPEAT_DIVISIONS / 4096;
+        int32_t sliceFine = (tapIntervalFine << 1) >> division;
+        int32_t maxSlice = (bufferHistory - REPEAT_FADE) >> 1;
+        if (maxSlice > REPEAT_MAX_SLICE) maxSlice = REPEAT_MAX_SLICE;
+        if (maxSlice < 2 * REPEAT_FADE) maxSlice = 2 * REPEAT_FADE;
+        if (sliceFine > (maxSlice << 7)) sliceFine = maxSlice << 7;
+        if (sliceFine < ((2 * REPEAT_FADE) << 7)) sliceFine = (2 * REPEAT_FADE) << 7;
+
+        // Y: three styles, decay per slice rising through each from none to half
+        int32_t styleKnob = KnobVal(Y);
+        RepeatStyle style = (RepeatStyle)(styleKnob * 3 / 4096);
+        int32_t decay = ((styleKnob - style * 1365) * 3) >> 1;  // 0-2047
+        if (decay > 2047) decay = 2047;
+
+        // Pulse In 2 going high captures the audio before this sample. A slice that
+        // was already playing fades out as the new one starts.
+        bool gate = PulseIn2();
+        bool capture = gate && !lastRepeatGate;
+        lastRepeatGate = gate;
+        int32_t pos = slicePosFine >> 7;
+        if (repeating && (capture || clockEdge || slicePosFine >= sliceFine)) {
+            fadeCapture = captureIndex;
+            fadeStyle = lastRepeatStyle;
+            fadeLength = sliceLength;
+            fadePos = pos;
+            fadeGain = sliceGain;
+            fadeCount = REPEAT_FADE;
+            sliceGain = (sliceGain * (4095 - decay) + 2048) >> 12;
+            // A clock edge restarts the slice at the edge's sample; otherwise the
+            // remainder carries the Q7 position over
+            slicePosFine = clockEdge ? (clockAge << 7) : (slicePosFine >= sliceFine) ? slicePosFine - sliceFine : 0;
+            sliceLength = sliceFine >> 7;
+        }
+        if (capture) {
+            if (!repeating) fadeCount = 0;
+            repeating = true;
+            captureIndex = delayLine.WriteIndex();
+            captureWritten = 0;
+            slicePosFine = 0;
+            sliceGain = 4095;
+            sliceLength = sliceFine >> 7;
+        }
+        lastRepeatStyle = style;
+
+        // Level ramps from the input to the repeats and back
+        if (gate && repeatLevel < 4095) repeatLevel += 32;
+        if (!gate && repeatLevel > 0) repeatLevel -= 32;
+        if (repeatLevel > 4095) repeatLevel = 4095;
+        if (repeatLevel < 0) repeatLevel = 0;
+        if (!gate && repeatLevel == 0) repeating = false;
+
+        int32_t wet = audioIn;
+        if (repeating) {
+            int32_t slice = (readSlice(captureIndex, style, sliceLength, slicePosFine >> 7) * sliceGain + 2048) >> 12;
+            if (fadeCount > 0) {
+                int32_t old = (readSlice(fadeCapture, fadeStyle, fadeLength, fadePos) * fadeGain + 2048) >> 12;
+                slice = (slice * (REPEAT_FADE - fadeCount) + old * fadeCount) >> 7;
+                fadePos++;
+                fadeCount--;
+            }
+            slicePosFine += 128;
+
+            mixer.SetMix(mixSetting);
+            int32_t mixed = mixer.Mix(Sample::FromRaw(audioIn), Sample::FromRaw(slice)).Raw();
+            wet = audioIn + (((mixed - audioIn) * repeatLevel + 2048) >> 12);
+        }
+
+        // Keep writing until the fade past the capture point is in the buffer,
+        // then hold it, so that the captured audio stays while the gate is high.
+        // Writing resumes as the gate falls, ahead of the slice the release still
+        // reads, so that a capture during the release takes the latest input.
+        if (!gate || !repeating || captureWritten < REPEAT_FADE) {
+            delayLine.Write((int16_t)audioIn);
+            delayLine.Advance();
+            if (bufferHistory < MAX_DELAY_SIZE) bufferHistory++;
+            if (repeating) captureWritten++;
+        }
+        return wet;
+    }
+
+    void output(int32_t dry, int32_t wetLeft, int32_t wetRight) {
+        mixer.SetMix(mixSetting);  // 0-4095
+
+        Fixed<12, 0> mixedLeft, mixedRight;
+        mixer.Mix(Sample::FromRaw(dry), Sample::FromRaw(wetLeft), Sample::FromRaw(wetRight), mixedLeft, mixedRight);
+        int32_t mixedOutputLeft = mixedLeft.Raw();
+        int32_t mixedOutputRight = mixedRight.Raw();
+        clip(mixedOutputLeft);
+        clip(mixedOutputRight);
+
+        AudioOut1((int16_t)mixedOutputLeft);
+        AudioOut2((int16_t)mixedOutputRight);
+    }
+
+    // LEDs 2-5: the mode, or with the switch up, the tone
+    // CLEAN: LED 2, SATURATION: LED 3, SHIMMER: LED 4, LOFI: LED 5,
+    // CHORUS: LEDs 2+3, FLANGER: LEDs 3+4, VIBRATO: LEDs 4+5, LOOPER: LEDs 2+5,
+    // REPEAT: LEDs 2+4, DIFFUSE: LEDs 3+5
+    // Tone: LED 2 dark, LEDs 3+4 flat, LED 5 thin
+    void showMode(Switch switchPos) {
+        static const uint8_t modeLeds[NUM_MODES] = {0x1, 0x2, 0x4, 0x8, 0x3, 0x6, 0xC, 0x9, 0x5, 0xA};
+        if (switchPos == Up) {
+            LedOn(2, toneType == DARK);
+            LedOn(3, toneType == FLAT);
+            LedOn(4, toneType == FLAT);
+            LedOn(5, toneType == THIN);
+        } else {
+            for (int i = 0; i < 4; i++) LedOn(2 + i, (modeLeds[currentMode] >> i) & 1);
+        }
+    }
+
+public:
+    explicit AudioDelay(Role role = Standalone) : ComputerCardT(role),
+                   diffuser(delayLine.SpareStorage(), diffuserLengths, DIFFUSION), bufferHistory(0), smoothedDelay(0), lastRawControl(0), ledCounter(0),
+                   currentMode(CLEAN), lastSwitchDown(true),
+                   modLine(delayLine.Storage()), modFilled(0), modSwing(0),
+                   loopBuffer((uint8_t *)delayLine.Storage()), loopState(LOOP_EMPTY), loopHead(0), loopHeld(0),
+                   loopStart(0), loopLength(0), loopPos(0), loopStartTime(0), loopFaded(0),
+                   overdubbing(false), overdubLevel(0),
+                   repeating(false), lastRepeatGate(false), repeatLevel(0), captureIndex(0), captureWritten(0),
+                   sliceLength(0), slicePosFine(0), sliceGain(0), lastRepeatStyle(FORWARD),
+                   fadeCapture(0), fadeStyle(FORWARD), fadeLength(0), fadePos(0), fadeGain(0), fadeCount(0),
+                   mixSetting(0), mixLive(true), toneType(FLAT), toneSetting(2048),
+                   hpfState(0), shimmerHpfState(0), saturationAccum(0),
+                   lastTapTime(0), tapIntervalFine(24000 << 7), tapTimeout(0), tapTempoActive(false),
+                   sampleCounter(0),
+                   lastFreezeActive(false), frozenWritePos(0), frozenDelayTimeL(0), frozenDelayTimeR(0) {
+    }
+
+protected:
+    void ProcessSample() override {
+
+        int16_t audioIn1 = AudioIn1();
+        int16_t audioIn2 = AudioIn2();
+
+        int32_t audioIn = ((int32_t)audioIn1 + (int32_t)audioIn2 + 1) >> 1;
+
+        Switch switchPos = SwitchVal();
+        bool switchDown = (switchPos == Down);
+        if (switchDown && !lastSwitchDown) {
+            // Leaving the looper, the buffer holds its packed samples, not audio
+            if (currentMode == LOOPER) bufferHistory = 0;
+            currentMode = (DelayMode)((currentMode + 1) % NUM_MODES);
+            if (currentMode == CHORUS) modFilled = 0;
+            if (currentMode == LOOPER) clearLoop();
+            // The allpasses still hold the tail from the last time in DIFFUSE
+            if (currentMode == DIFFUSE) diffuser.Clear();
+            if (currentMode != LOOPER) PulseOut1(false);
+            repeating = false;
+            repeatLevel = 0;
+        }
+        lastSwitchDown = switchDown;
+
+        // Switch up: the Main knob sets the tone, and the mix waits to pick it up again
+        int32_t mainKnob = KnobVal(Main);
+        if (switchPos == Up) {
+            setTone(mainKnob);
+            mixLive = false;
+        } else {
+            int32_t distance = mainKnob - mixSetting;
+            if (distance < 0) distance = -distance;
+            if (distance < PICKUP_RANGE) mixLive = true;
+            if (mixLive) mixSetting = mainKnob;
+        }
+
+        if (currentMode == LOOPER) {
+            // Pulse In 1 works the looper, so tap tempo is off
+            tapTempoActive = false;
+            int32_t wet = processLooper(audioIn);
+            output(audioIn, wet, wet);
+
+            // Pulse Out 1 and LED 0 mark the start of each pass, LED 0 is on
+            // throughout recording, and LED 1 while overdubbing
+            bool loopClock = (loopState == LOOP_PLAYING) && loopPos < LOOP_PULSE_SAMPLES;
+            PulseOut1(loopClock);
+            LedOn(0, loopClock || loopState == LOOP_RECORDING || loopState == LOOP_CLOSING);
+            LedOn(1, overdubbing);
+            showMode(switchPos);
+            return;
+        }
+
+        // TAP TEMPO
+        PulseEdge edges[4];
+        int numEdges = PulseInEdges(0, edges, 4);
+        bool clockEdge = false;  // for beat repeat
+        for (int i = 0; i < numEdges; i++) {
+            if (!edges[i].rising) continue;
+            clockEdge = true;
+
+            // Rising edge - new tap
+            uint32_t timeSinceLastTap = edges[i].time - lastTapTime;
+
+            // Only accept taps within reasonable range (50ms to 3 seconds)
+            if (timeSinceLastTap >= 50000 && timeSinceLastTap <= 3000000) {
+                // microseconds to samples (Q7): x 48 x 128 / 1000
+                tapIntervalFine = (int32_t)((timeSinceLastTap * 768 + 62) / 125);
+                tapTempoActive = true;
+                tapTimeout = sampleCounter + 240000;
+            }
+            lastTapTime = edges[i].time;
+        }
+
+        // Timeout: If no tap for 5 seconds, return to knob control
+        if (tapTempoActive && (int32_t)(sampleCounter - tapTimeout) >= 0) {
+            tapTempoActive = false;
+        }
+
+        sampleCounter++;
+
+        if (currentMode == REPEAT) {
+            int32_t wet = processRepeat(audioIn, clockEdge, samplesSince(lastTapTime));
+            clip(wet);
+            AudioOut1((int16_t)wet);
+            AudioOut2((int16_t)wet);
+
+            // LED 0 at the start of each slice, LED 1 while repeating
+            LedOn(0, repeating && (slicePosFine >> 7) < 480);
+            LedOn(1, repeating);
+            showMode(switchPos);
+            return;
+        }
+
+        if (currentMode >= CHORUS && currentMode <= VIBRATO) {
+            int32_t wetLeft, wetRight;
+            processModulation(audioIn, wetLeft, wetRight);
+            output(audioIn, wetLeft, wetRight);
+
+            // LED 0 follows the LFO, LED 1 is on above half depth
+            LedOn(0, lfo.Sine() > 0);
+            LedOn(1, modSwing > (modShapes[currentMode - CHORUS].maxSwing << 7));
+            showMode(switchPos);
+            return;
+        }
+
+        int32_t delayKnob = KnobVal(X);
+
+        int16_t cv1 = CVIn1();
+
+        // DELAY TIME
+        int32_t combinedControl = delayKnob + cv1;
+        if (combinedControl > 4095) combinedControl = 4095;
+        if (combinedControl < 0) combinedControl = 0;
+
+        // Apply hysteresis to prevent ADC noise from causing micro-modulation
+        // Only update if change is significant (threshold of 8 out of 4095 = ~0.2%)
+        if (currentMode != LOFI) {
+            const int32_t HYSTERESIS_THRESHOLD = 8;
+            int32_t controlDelta = combinedControl - lastRawControl;
+            if (controlDelta < 0) controlDelta = -controlDelta;
+
+            if (controlDelta >= HYSTERESIS_THRESHOLD) {
+                lastRawControl = combinedControl;
+            } else {
+                combinedControl = lastRawControl;
+            }
+        } else {
+            // LOFI mode: no hysteresis
+            lastRawControl = combinedControl;
+        }
+
+        const int32_t MIN_DELAY = 100;
+        const int32_t MAX_DELAY = 95000;
+
+        int32_t targetDelayFine;
+        if (tapTempoActive) {
+            // Tap tempo mode: Use measured tap interval, keeping its sub-sample part
+            targetDelayFine = tapIntervalFine;
+            if (targetDelayFine < (MIN_DELAY << 7)) targetDelayFine = MIN_DELAY << 7;
+            if (targetDelayFine > (MAX_DELAY << 7)) targetDelayFine = MAX_DELAY << 7;
+        } else {
+            // Manual mode: Use knob + CV
+            int32_t delayRange = MAX_DELAY - MIN_DELAY;
+            targetDelayFine = (MIN_DELAY + (combinedControl * delayRange) / 4095) << 7;
+        }
+
+        // Exponential smoothing: (smoothedDelay * 255 + target + 128) >> 8, with no
+        // 64-bit product (smoothedDelay * 255 overflows 32 bits)
+        smoothedDelay += (targetDelayFine - smoothedDelay + 128) >> 8;
+
+        // SHIMMER MODE: Fixed pitch shift of +7 semitones
+        int32_t pitchModulation = 0;
+        if (currentMode == SHIMMER) {
+            // INITIAL SHIFT: +7 semitones = perfect fifth up
+            //   Ratio = 2^(7/12) = 1.4983
+            //   Delay = 1/1.4983 = 0.6674 = -33.26% change
+            //   Fixed point: -21782
+            //
+            //   Each feedback repeat adds +7 semitones (perfect fifth)
+            //   Input: original pitch (0)
+            //   1st echo: +7 semitones (perfect fifth)
+            //   2nd echo: +14 semitones (major ninth)
+            //   3rd echo: +21 semitones (octave + major sixth)
+            //   4th echo: +28 semitones (2 octaves + perfect fourth)
+            //   5th echo: +35 semitones (2 octaves + major ninth)
+
+            int32_t pitchMod = -21782;
+
+            // (smoothedDelay * pitchMod +/- 32768) >> 16, in 32 bits: smoothedDelay
+            // (under 2^24) is split at bit 8, so that each partial product fits
+            int32_t high = (smoothedDelay >> 8) * pitchMod;
+            int32_t low = (smoothedDelay & 0xFF) * pitchMod;
+            int32_t rounding = (smoothedDelay > 0) ? -32768 : 32768;
+            pitchModulation = (high + ((low + rounding) >> 8)) >> 8;
+        }
+
+        int32_t modulatedDelay = smoothedDelay + pitchModulation;
+
+        // Clamp modulated delay to valid range
+        int32_t minDelayFine = MIN_DELAY << 7;
+        int32_t maxDelayFine = MAX_DELAY << 7;
+        if (modulatedDelay < minDelayFine) modulatedDelay = minDelayFine;
+        if (modulatedDelay > maxDelayFine) modulatedDelay = maxDelayFine;
+
+        // STEREO
+        int32_t modulatedDelayRight;
+        if (currentMode == CLEAN || currentMode == LOFI) {
+            modulatedDelayRight = modulatedDelay;
+        } else if (currentMode == SATURATION) {
+            // SATURATION mode: 1% stereo offset
+            modulatedDelayRight = modulatedDelay + modulatedDelay / 100;
+        } else {
+            // SHIMMER and DIFFUSE modes: 10% stereo offset
+            modulatedDelayRight = modulatedDelay + modulatedDelay / 10;
+        }
+
+        if (modulatedDelayRight < minDelayFine) modulatedDelayRight = minDelayFine;
+        if (modulatedDelayRight > maxDelayFine) modulatedDelayRight = maxDelayFine;
+
+        // FREEZE DETECTION
+        bool freezeActive = PulseIn2();
+        int32_t writeIndex = delayLine.WriteIndex();
+        if (freezeActive && !lastFreezeActive) {
+            frozenWritePos = writeIndex;
+            frozenDelayTimeL = modulatedDelay >> 7;
+            frozenDelayTimeR = modulatedDelayRight >> 7;
+        }
+        lastFreezeActive = freezeActive;
+
+        int32_t delayInSamplesLeft, delayInSamplesRight;
+        int32_t effectiveWriteIndex;
+
+        if (freezeActive) {
+            int32_t advancedSamples = writeIndex - frozenWritePos;
+            if (advancedSamples < 0) advancedSamples += MAX_DELAY_SIZE;
+
+            delayInSamplesLeft = frozenDelayTimeL;
+            delayInSamplesRight = frozenDelayTimeR;
+
+            effectiveWriteIndex = frozenWritePos + (advancedSamples % (frozenDelayTimeL + 1));
+            if (effectiveWriteIndex >= MAX_DELAY_SIZE) effectiveWriteIndex -= MAX_DELAY_SIZE;
+        } else {
+            delayInSamplesLeft = DelayTime::FromRaw(modulatedDelay).Int();
+            delayInSamplesRight = DelayTime::FromRaw(modulatedDelayRight).Int();
+            effectiveWriteIndex = writeIndex;
+        }
+
+        // Interpolated reads: 7-bit delay fraction scaled to the 8-bit blend
+        int32_t fractionLeft = DelayTime::FromRaw(modulatedDelay).Frac();
+        int32_t delayedSampleLeft = delayLine.ReadAt(effectiveWriteIndex - delayInSamplesLeft - 1, fractionLeft << 1);
+
+        // Under high interrupt load, drop the separate right tap and share the left one
+        int32_t delayedSampleRight = delayedSampleLeft;
+        if (QualityLevel() == Full) {
+            int32_t fractionRight = DelayTime::FromRaw(modulatedDelayRight).Frac();
+            delayedSampleRight = delayLine.ReadAt(effectiveWriteIndex - delayInSamplesRight - 1, fractionRight << 1);
+        }
+
+        // Nothing to repeat from beyond the audio written since the looper
+        if (delayInSamplesLeft >= bufferHistory) delayedSampleLeft = 0;
+        if (delayInSamplesRight >= bufferHistory) delayedSampleRight = 0;
+
+        int32_t delayedSample = delayedSampleLeft;
+
+        // FEEDBACK
+        int32_t feedbackKnob = KnobVal(Y);
+
+        int16_t cv2 = CVIn2();
+
+        int32_t combinedFeedback = feedbackKnob + cv2;
+        if (combinedFeedback > 4095) combinedFeedback = 4095;
+        if (combinedFeedback < 0) combinedFeedback = 0;
+
+        int32_t inputGain = 4095 - ((combinedFeedback * combinedFeedback + 2048) >> 12);
+        int32_t feedbackGain = 4095 - (((4095 - combinedFeedback) * (4095 - combinedFeedback) + 2048) >> 12);
+
+        const int32_t MIN_INPUT_GAIN = 205;  // ~5% of 4095
+        if (inputGain < MIN_INPUT_GAIN) inputGain = MIN_INPUT_GAIN;
+
+        int32_t feedbackSignal = Multiply<11, 0>(Sample::FromRaw(delayedSample), Gain::FromRaw(feedbackGain)).Raw();
+
+        if (currentMode == SATURATION) {
+            feedbackSignal = warmSaturate(feedbackSignal);
+            int32_t dynamicGain;
+            if (saturationAccum < 150) {
+                dynamicGain = 1740 + (saturationAccum << 2);
+            } else {
+                int32_t decay = saturationAccum - 150;
+                dynamicGain = 2340 - ((decay * 5 + 1) >> 1);
+                if (dynamicGain < 1126) dynamicGain = 1126;
+            }
+
+            feedbackSignal = (feedbackSignal * dynamicGain + 1024) >> 11;
+        } else if (currentMode == SHIMMER) {
+            feedbackSignal = shimmerHighpass(feedbackSignal);
+        }
+
+        // TONE: darken or thin each repeat
+        if (toneType != FLAT) {
+            toneFilter.Process(feedbackSignal);
+            feedbackSignal = (toneType == DARK) ? toneFilter.Low() : toneFilter.High();
+        }
+
+        int32_t mixedSignal = Multiply<11, 0>(Sample::FromRaw(audioIn), Gain::FromRaw(inputGain)).Raw() + feedbackSignal;
+
+        if (currentMode == DIFFUSE) {
+            mixedSignal = diffuser.Process(mixedSignal);
+        }
+
+        int32_t filteredSignal = highpass(mixedSignal);
+
+        if (filteredSignal > 2047) filteredSignal = 2047;
+        if (filteredSignal < -2047) filteredSignal = -2047;
+
+        if (!freezeActive) {
+            delayLine.Write((int16_t)filteredSignal);
+            if (bufferHistory < MAX_DELAY_SIZE) bufferHistory++;
+        }
+
+        delayLine.Advance();
+
+        output(audioIn, delayedSampleLeft, delayedSampleRight);
+
+        // LEDs
+        ledCounter++;
+        int32_t blinkRate = delayInSamplesLeft / 2;
+        if (blinkRate < 100) blinkRate = 100;
+
+        // LED 0: Delay time indicator
+        if (ledCounter >= blinkRate) {
+            ledCounter = 0;
+            LedOn(0, true);
+        } else if (ledCounter >= blinkRate / 2) {
+            LedOn(0, false);
+        }
+
+        // LED 1: Feedback amount indicator (on when > 50%)
+        if (combinedFeedback > 2048) {
+            LedOn(1, true);
+        } else {
+            LedOn(1, false);
+        }
+
+        showMode(switchPos);
+    }
+};
+
+#endif
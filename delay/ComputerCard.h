@@ -19,7 +19,10 @@ See examples/ directory
 #define COMPUTERCARD_H
 
 #include "hardware/gpio.h"
+#include "hardware/interp.h"
+#include "hardware/irq.h"
 #include "hardware/pwm.h"
+#include "hardware/sync.h"
 
 #define PULSE_1_RAW_OUT 8
 #define PULSE_2_RAW_OUT 9
@@ -46,23 +49,154 @@ public:
 	enum HardwareVersion_t {Proto1=0x2a, Proto2_Rev1=0x30, Rev1_1=0x0C, Unknown=0xFF};
 	/// USB Power state
 	enum USBPowerState_t {DFP, UFP, Unsupported};
+	/// Processing quality suggested by the audio interrupt load, used by QualityLevel
+	enum Quality {Full, Reduced, Minimal};
+	/// What a card is constructed as: the card the Computer runs, or an engine run by
+	/// another card's ProcessSample (see ProcessEngineSample), which touches no hardware
+	enum Role {Standalone, Engine};
+
+	/// Pulse input edge, as returned by PulseInEdges
+	struct PulseEdge
+	{
+		uint32_t time; ///< microseconds, on the time_us_32() clock
+		bool rising; ///< true for the start of a pulse
+	};
+
+	/// Edges held for each pulse input, see PulseInEdges
+	static constexpr uint32_t pulseEdgeQueueSize = 16; // power of two
 
-	ComputerCard();
+	explicit ComputerCard(Role role = Standalone);
+
+	/// Task function run on core 0 outside the audio interrupt, see AddBackgroundTask and PostTask
+	typedef void (*TaskFunction)(void *context, uint32_t arg);
+
+	static constexpr int maxBackgroundTasks = 8; // including the LED update task
 
 	/** \brief Start audio processing.
 
         The Run method starts audio processing, calling ProcessSample using an interrupt.
-        Run is a blocking function (it never returns)
+        Run is a blocking function (it never returns). Between audio interrupts, core 0
+        sleeps, waking to run background tasks and jobs posted by PostTask.
 	*/
 	void Run()
 	{
 		ComputerCard::thisptr = this;
-		AudioWorker();
+		AudioWorker(ComputerCard::AudioCallback);
 	}
 
+	/** \brief Add a background task, before Run()
+
+        After every interrupt on core 0 (so at least once per audio sample), Run calls
+        each background task whose period has elapsed, with arg set to time_us_32().
+        Tasks with period 0 are called after every interrupt.
+        Tasks run cooperatively and are preempted by the audio interrupt, so a long task
+        won't cause audio glitches, but does delay other tasks until it returns.
+        Returns false if maxBackgroundTasks tasks have already been added.
+	*/
+	bool AddBackgroundTask(TaskFunction task, void *context, uint32_t periodMicroseconds = 0);
+
 	/// Use before Run() to enable Connected/Disconnected detection
 	void EnableNormalisationProbe() {useNormProbe = true;}
-	
+
+	/** \brief Use before Run() to sample both CV inputs at 48kHz, rather than alternately at 24kHz
+
+        The CV multiplexer is then switched mid-frame by a short, high priority interrupt,
+        chained from the first half of the ADC DMA. Knobs are scanned at the same rate as before.
+	*/
+	void EnableAudioRateCV() {audioRateCV = true;}
+
+	/// Set CV input smoothing, a one-pole lowpass with coefficient 2^-shift.
+	/// The default, 4, gives ~240Hz cutoff (~480Hz with audio-rate CV); 0 bypasses smoothing.
+	void SetCVSmoothing(uint8_t shift) {cvSmoothing = shift;}
+
+	/// Use before Run() to show audio interrupt load on the debug pins:
+	/// DEBUG_1 is high while the audio interrupt runs, DEBUG_2 while QualityLevel() is not Full.
+	/// Not available with ENABLE_UART_DEBUGGING.
+	void EnableLoadDebugPins() {loadDebugPins = true;}
+
+	/// Use before Run() to record timestamped pulse input edges, read with PulseInEdges.
+	/// Edges are captured by a GPIO interrupt at higher priority than the audio interrupt.
+	void EnablePulseInEdgeCapture() {usePulseEdgeCapture = true;}
+
+
+	/// Use before Run() if code outside ProcessSample on core 0 also uses the
+	/// interpolators, so that the audio interrupt saves and restores their state
+	void PreserveInterpolators() {preserveInterp = true;}
+
+	/// Configure this core's INTERP0 as used by InterpDelayLine.
+	/// Called by Run(); only needed directly when using InterpDelayLine without Run()
+	static void ConfigureInterpolators();
+
+	/// Fill the unused part of core 0's stack with a pattern, for StackHighWater. Called by Run().
+	static void PaintStack();
+
+	/// Return the most of core 0's stack reservation used since PaintStack, in bytes.
+	/// This includes interrupts, which share the main stack. Returning the whole
+	/// reservation means the stack has probably overflowed it.
+	static uint32_t StackHighWater();
+
+
+	/** \brief Control trace fields
+
+        Building with COMPUTERCARD_TRACE_SIZE defined (bytes) records the inputs that
+        ProcessSample sees, from the first sample until the buffer is full, then prints
+        the trace over USB serial every few seconds. COMPUTERCARD_TRACE_AUDIO adds the
+        audio inputs. The trace is a byte stream of entries, in sample order, recorded
+        only when a field changes: a tag byte, field << 4 | samples since the previous
+        entry (15: the rest follow as a varint), then the value. Knobs, CV and audio are
+        zigzag varint deltas; pulse edges are varints of zigzag(time offset from
+        TraceSampleTime) << 1 | rising; the other fields are one byte. Fields start at zero.
+	*/
+	enum TraceField {TraceKnobMain, TraceKnobX, TraceKnobY, TraceCV1, TraceCV2, TraceAudio1, TraceAudio2,
+		TraceSwitch, TracePulse, TraceConnected, TraceQuality, TracePulseEdge1, TracePulseEdge2, numTraceFields};
+
+	/// Inputs for one sample, decoded from a control trace, for ReplaySample
+	struct TraceInputs
+	{
+		int32_t knobs[3];
+		int16_t cv[2];
+		int16_t audio[2];
+		bool pulse[2];
+		bool connected[6];
+		Switch switchVal;
+		Quality quality;
+		uint32_t sampleTime; ///< TraceSampleTime of this sample
+		uint8_t numEdges[2];
+		PulseEdge edges[2][pulseEdgeQueueSize]; ///< in the order PulseInEdges returned them
+	};
+
+	/// Time of sample n of a trace on its nominal clock, in microseconds from the first sample
+	static uint32_t TraceSampleTime(uint32_t n) {return (uint32_t)(((uint64_t)n * 125) / 6);}
+
+	/** \brief Run ProcessSample once, with inputs from a control trace, rather than the hardware
+
+        Used by the host replay tools (see host/) on a card that hasn't been Run. Replaying
+        a trace's samples in order through a newly constructed card reproduces the outputs
+        the card produced while recording, as long as ProcessSample depends only on the
+        traced inputs (not SampleTime, ISRLoad or calibrated CV outputs), and the audio
+        inputs were either traced or are supplied from the same recording.
+
+        The CV and pulse outputs are kept per card, rather than set on the hardware, so that
+        several cards can be replayed side by side, or on several threads. If pulseOut is
+        given, it receives the pulse outputs.
+        LEDs set during replay are not lit, but kept for ReplayLedLevel.
+	*/
+	void ReplaySample(const TraceInputs &inputs, int16_t audioOut[2], int32_t cvOut[2], bool pulseOut[2] = nullptr);
+
+	/** \brief Run ProcessSample once, for a card constructed as an Engine
+
+        Lets one card run others inside its own ProcessSample, on either core: the owning
+        card collects each engine's inputs, in the form a trace records them, and does what
+        it likes with the outputs. cvOut is as CVOutPrecise's value. An engine touches no
+        hardware: its CV, pulse and LED outputs are kept in the card, and returned here or
+        by ReplayLedLevel. Its switch changes are as the owner passes them in. It must not
+        use calibrated CV outputs, and may only PostTask when run in the audio interrupt.
+	*/
+	void ProcessEngineSample(const TraceInputs &inputs, int16_t audioOut[2], int32_t cvOut[2], bool pulseOut[2]);
+
+	/// LED PWM level set by the card during ReplaySample or ProcessEngineSample, 0-65535
+	uint16_t ReplayLedLevel(uint32_t index) const {return ledLevels[index];}
+
 	static ComputerCard *ThisPtr() {return thisptr;}
 
 protected:
@@ -72,6 +206,26 @@ protected:
 
 
 
+	/** \brief Post a job from ProcessSample, to run on core 0 outside the audio interrupt
+
+        Use for work too slow for the audio interrupt (printing, etc.). Not for flash
+        writes: an erase stops execution from flash, and so any card code or tables
+        there, for tens of milliseconds, which the audio interrupt can't wait for.
+        Jobs run in the order posted, before background tasks, once ProcessSample returns.
+        The job queue is lock-free and must only be posted to from ProcessSample.
+        Returns false, dropping the job, if jobQueueSize jobs are already waiting.
+	*/
+	bool __not_in_flash_func(PostTask)(TaskFunction task, void *context, uint32_t arg = 0)
+	{
+		uint32_t head = jobQueueHead;
+		if (head - jobQueueTail >= jobQueueSize) return false;
+		jobQueue[head & (jobQueueSize - 1)] = {task, context, arg};
+		__dmb(); // job visible to background loop before head moves
+		jobQueueHead = head + 1;
+		return true;
+	}
+
+
 	/// Read knob position (returns 0-4095)
 	int32_t __not_in_flash_func(KnobVal)(Knob ind) {return knobs[ind];}
 
@@ -106,7 +260,7 @@ protected:
 	{
 		if (val<-2048) val = -2048;
 		if (val > 2047) val = 2047;
-		cvValue[i] = (2047-val)<<7;
+		SetCVValue(i, (2047-val)<<7);
 	}
 	
 	/// Set CV 1 output (values -2048 to 2047)
@@ -114,7 +268,7 @@ protected:
 	{
 		if (val<-2048) val = -2048;
 		if (val > 2047) val = 2047;
-		cvValue[0] = (2047-val)<<7;
+		SetCVValue(0, (2047-val)<<7);
 	}
 	
 	/// Set CV 2 output (values -2048 to 2047)
@@ -122,7 +276,7 @@ protected:
 	{
 		if (val<-2048) val = -2048;
 		if (val > 2047) val = 2047;
-		cvValue[1] = (2047-val)<<7;
+		SetCVValue(1, (2047-val)<<7);
 	}
 
 		
@@ -131,7 +285,7 @@ protected:
 	{
 		if (val<-262144) val = -262144;
 		if (val > 262143) val = 262143;
-		cvValue[i] = 262143-val;
+		SetCVValue(i, 262143-val);
 	}
 	
 	/// Set CV 1 output (values -262144 to 262143)
@@ -139,7 +293,7 @@ protected:
 	{
 		if (val<-262144) val = -262144;
 		if (val > 262143) val = 262143;
-		cvValue[0] = 262143-val;
+		SetCVValue(0, 262143-val);
 	}
 	
 	/// Set CV 2 output (values -262144 to 262143)
@@ -147,25 +301,25 @@ protected:
 	{
 		if (val<-262144) val = -262144;
 		if (val > 262143) val = 262143;
-		cvValue[1] = 262143-val;
+		SetCVValue(1, 262143-val);
 	}
 
 	/// Set CV 1 output from calibrated MIDI note number (values 0 to 127)
 	void __not_in_flash_func(CVOutMIDINote)(int i, uint8_t noteNum)
 	{
-		cvValue[i] = MIDIToDAC(noteNum, i);
+		SetCVValue(i, MIDIToDAC(noteNum, i));
 	}
 	
 	/// Set CV 1 output from calibrated MIDI note number (values 0 to 127)
 	void __not_in_flash_func(CVOut1MIDINote)(uint8_t noteNum)
 	{
-		cvValue[0] = MIDIToDAC(noteNum, 0);
+		SetCVValue(0, MIDIToDAC(noteNum, 0));
 	}
 	
 	/// Set CV 2 output from calibrated MIDI note number (values 0 to 127)
 	void __not_in_flash_func(CVOut2MIDINote)(uint8_t noteNum)
 	{
-		cvValue[1] = MIDIToDAC(noteNum, 1);
+		SetCVValue(1, MIDIToDAC(noteNum, 1));
 	}
 
 	
@@ -173,7 +327,7 @@ protected:
 	bool __not_in_flash_func(CVOutMillivolts)(int i, int32_t millivolts)
 	{
 		bool limited = false;
-		cvValue[i] = MillivoltsToDAC(millivolts, i, limited);
+		SetCVValue(i, MillivoltsToDAC(millivolts, i, limited));
 		return limited;
 	}
 	
@@ -181,7 +335,7 @@ protected:
 	bool __not_in_flash_func(CVOut1Millivolts)(int32_t millivolts)
 	{
 		bool limited = false;
-		cvValue[0] = MillivoltsToDAC(millivolts, 0, limited);
+		SetCVValue(0, MillivoltsToDAC(millivolts, 0, limited));
 		return limited;
 	}
 	
@@ -189,7 +343,7 @@ protected:
 	bool __not_in_flash_func(CVOut2Millivolts)(int32_t millivolts)
 	{
 		bool limited = false;
-		cvValue[1] = MillivoltsToDAC(millivolts, 1, limited);
+		SetCVValue(1, MillivoltsToDAC(millivolts, 1, limited));
 		return limited;
 	}
 
@@ -197,19 +351,19 @@ protected:
 	/// Set Pulse output (true = on)
 	void __not_in_flash_func(PulseOut)(int i, bool val)
 	{
-		gpio_put(PULSE_1_RAW_OUT + i, !val);
+		SetPulseOut(i, val);
 	}
 	
 	/// Set Pulse 1 output (true = on)
 	void __not_in_flash_func(PulseOut1)(bool val)
 	{
-		gpio_put(PULSE_1_RAW_OUT, !val);
+		SetPulseOut(0, val);
 	}
 	
 	/// Set Pulse 2 output (true = on)
 	void __not_in_flash_func(PulseOut2)(bool val)
 	{
-		gpio_put(PULSE_2_RAW_OUT, !val);
+		SetPulseOut(1, val);
 	}
 	
 	/// Return audio in (-2048 to 2047)
@@ -252,6 +406,20 @@ protected:
 	bool __not_in_flash_func(PulseIn2RisingEdge)(){return pulse[1] && !last_pulse[1];}
 
 
+	/** \brief Take edges recorded on pulse input i since the last call
+
+        Requires EnablePulseInEdgeCapture. Copies up to maxEdges edges, oldest first,
+        into edges, and returns the number copied. Unlike the polled PulseIn functions,
+        this catches pulses shorter than a sample, and timestamps them to the microsecond;
+        compare with SampleTime() for sub-sample timing.
+        Up to pulseEdgeQueueSize edges are held for each input, so call every sample.
+	*/
+	int PulseInEdges(int i, PulseEdge *edges, int maxEdges);
+
+	/// Time (microseconds, on the time_us_32() clock) at which this sample's inputs were collected
+	uint32_t __not_in_flash_func(SampleTime)(){return sampleTime;}
+
+
 	/// Return true if jack connected to input
 	bool __not_in_flash_func(Connected)(Input i){return connected[i];}
 	/// Return true if no jack connected to input
@@ -265,19 +433,19 @@ protected:
 	// 4 5
 	void __not_in_flash_func(LedBrightness)(uint32_t index, uint16_t value)
 	{
-		pwm_set_gpio_level(leds[index], (value*value)>>8);
+		SetLedLevel(index, (value*value)>>8);
 	}
 	
 	/// Turn LED on/off
 	void __not_in_flash_func(LedOn)(uint32_t index, bool value = true)
 	{
-		pwm_set_gpio_level(leds[index], value?65535:0);
+		SetLedLevel(index, value?65535:0);
 	}
 
 	/// Turn LED off
 	void __not_in_flash_func(LedOff)(uint32_t index)
 	{
-		pwm_set_gpio_level(leds[index], 0);
+		SetLedLevel(index, 0);
 	}
 
 	// Return power state of USB port
@@ -303,6 +471,21 @@ protected:
 		return uniqueID;
 	}	
 
+	/// Peak audio interrupt duration over the last block of samples, as a percentage of the sample period
+	uint32_t ISRLoad() const
+	{
+		return cyclesPerSample ? lastBlockPeakCycles * 100 / cyclesPerSample : 0;
+	}
+
+	/** \brief Processing quality that the card should use, based on audio interrupt load
+
+        Measured over blocks of loadBlockSize samples. If the interrupt's peak duration in
+        a block nears the sample period, the level drops (Full, Reduced, then Minimal), and
+        cards should drop optional processing (voices, extra taps, etc.) to avoid glitches.
+        The level rises again once the load has stayed low for about half a second.
+	*/
+	Quality __not_in_flash_func(QualityLevel)() const {return quality;}
+
 	/// Return true iff CV outputs are calibrated.
 	/// Returns false if using default calibration values.
 	bool CVOutsCalibrated() const
@@ -339,11 +522,22 @@ private:
 	CalCoeffs calCoeffs[calMaxChannels];
 
 	uint64_t uniqueID;
-	
-	uint8_t ReadByteFromEEPROM(unsigned int eeAddress);
-	int ReadIntFromEEPROM(unsigned int eeAddress);
+
+	// Calibration coefficients cached in flash, keyed by the EEPROM CRC,
+	// so that boot only reads the full EEPROM when the calibration changes
+	typedef struct
+	{
+		uint32_t magic;
+		uint16_t eepromCRC;
+		uint16_t cacheCRC; // of coeffs
+		CalCoeffs coeffs[calMaxChannels];
+	} CalCache;
+
+	bool ReadEEPROMBlock(unsigned int eeAddress, uint8_t *data, int length);
 	void CalcCalCoeffs(int channel);
 	int ReadEEPROM();
+	bool LoadCalCache(uint16_t eepromCRC);
+	void SaveCalCache(uint16_t eepromCRC);
 	uint32_t MIDIToDAC(int midiNote, int channel);
 	uint32_t MillivoltsToDAC(int millivolts, int channel, bool &limited);
 	
@@ -363,6 +557,11 @@ private:
 	volatile int32_t plug_state[6] = {0,0,0,0,0,0};
 	volatile bool connected[6] = {0,0,0,0,0,0};
 	bool useNormProbe;
+	bool usePulseEdgeCapture;
+	bool loadDebugPins;
+	bool audioRateCV;
+	uint8_t cvSmoothing;
+	bool preserveInterp;
 
 	Switch switchVal, lastSwitchVal;
 	
@@ -375,10 +574,17 @@ private:
 	uint16_t SPI_Buffer[2][2];
 
 	uint8_t adc_dma, spi_dma; // DMA ids
+	uint8_t adc2_dma; // second half of the ADC frame, with audio-rate CV
+	uint8_t adc_frame_dma; // ADC DMA channel that completes the frame
+
+	static void CVMuxCallback();
 
 
 
 	uint8_t dmaPhase = 0;
+	uint8_t cpuPhase = 0;
+
+	interp_hw_save_t interpSave;
 
 	// Convert signed int16 value into data string for DAC output
 	uint16_t __not_in_flash_func(dacval)(int16_t value, uint16_t dacChannel)
@@ -392,30 +598,844 @@ private:
 	
     void CorrectADCDNL(uint16_t &value) const;
 	
-	void BufferFull();
+	void CollectInputs();
+	void SendOutputs();
+
+	void __not_in_flash_func(BufferFull)()
+	{
+		CollectInputs();
+		ProcessSample();
+		SendOutputs();
+	}
 
-	void AudioWorker();
+	void AudioWorker(irq_handler_t callback);
 	
-	static void AudioCallback()
+	static void __not_in_flash_func(AudioCallback)()
 	{
 		thisptr->BufferFull();
 	}
 	static ComputerCard *thisptr;
+	irq_handler_t audioCallback;
+
+	template<class Derived> friend class ComputerCardT;
+
+	// Audio interrupt load measurement, in CPU cycles counted by SysTick
+	static constexpr int loadBlockSize = 64;
+	static constexpr int qualityRecoverBlocks = 375; // 0.5s
+	uint32_t isrStartCycles;
+	uint32_t cyclesPerSample, loadHighCycles, loadLowCycles;
+	uint32_t blockPeakCycles, lastBlockPeakCycles;
+	uint16_t loadBlockCount, lowLoadBlocks;
+	volatile Quality quality;
+	void UpdateQuality();
+
+	// Pulse input edge capture
+	// A GPIO interrupt timestamps each edge into a per-input
+	// single-producer (GPIO interrupt), single-consumer (PulseInEdges) queue
+	static PulseEdge pulseEdges[2][pulseEdgeQueueSize];
+	static volatile uint32_t pulseEdgeHead[2], pulseEdgeTail[2];
+	static void PulseEdgeIRQ();
+	uint32_t sampleTime;
+
+	// Control trace replay and engines: ReplaySample's or ProcessEngineSample's inputs,
+	// while ProcessSample runs, and the outputs, kept in the card while detached
+	const TraceInputs *replayInputs;
+	uint8_t replayEdgePos[2];
+	uint32_t replaySamples;
+	uint32_t replayCVValue[2];
+	bool replayPulseOut[2];
+	bool detached; // an engine, or a card being replayed: outputs stay in the card
+	void RunDetached(const TraceInputs &inputs, int16_t audioOut[2], int32_t cvOut[2], bool pulseOut[2]);
+
+	// LED PWM levels. While Run is processing audio, the interrupt only stores them,
+	// and UpdateLedsTask writes them to the PWM slices between interrupts.
+	static constexpr uint32_t ledUpdatePeriod = 500; // microseconds, about the LED PWM period
+	uint16_t ledLevels[numLeds];
+	bool ledsByTask;
+	static void UpdateLedsTask(void *context, uint32_t now);
+
+	void __not_in_flash_func(SetLedLevel)(uint32_t index, uint16_t level)
+	{
+		ledLevels[index] = level;
+		if (!ledsByTask && !detached) pwm_set_gpio_level(leds[index], level);
+	}
+
+	// CV and pulse outputs: the hardware, or for an engine or a replayed card its own copies,
+	// so that cards replayed side by side, or on several threads, don't share them
+	void __not_in_flash_func(SetCVValue)(int i, uint32_t value)
+	{
+		if (detached) replayCVValue[i] = value;
+		else cvValue[i] = value;
+	}
+
+	void __not_in_flash_func(SetPulseOut)(int i, bool val)
+	{
+		if (detached) replayPulseOut[i] = val;
+		else gpio_put(PULSE_1_RAW_OUT + i, !val);
+	}
+
+#ifdef COMPUTERCARD_TRACE_SIZE
+	// Control trace recording, from the first sample until the buffer is full
+	static uint8_t traceBuffer[COMPUTERCARD_TRACE_SIZE];
+	uint32_t traceLength; // bytes recorded
+	uint32_t traceSampleStart; // bytes recorded before the current sample
+	uint32_t traceSamples; // index of the current sample; once full, samples recorded
+	uint32_t traceLastEntry; // sample index of the previous entry
+	uint32_t traceStartTime;
+	int32_t traceLast[numTraceFields];
+	volatile uint8_t traceState;
+	void RecordTrace();
+	void TraceValue(int field, int32_t value);
+	void TraceEntry(int field, uint32_t value);
+	void __not_in_flash_func(TraceByte)(uint8_t b)
+	{
+		if (traceLength < COMPUTERCARD_TRACE_SIZE) traceBuffer[traceLength] = b;
+		traceLength++;
+	}
+	void __not_in_flash_func(TraceVarint)(uint32_t x)
+	{
+		for (; x >= 0x80; x >>= 7) TraceByte((x & 0x7F) | 0x80);
+		TraceByte(x);
+	}
+	static void DumpTraceTask(void *context, uint32_t now);
+#endif
+
+	// Background tasks, polled by AudioWorker between interrupts
+	struct BackgroundTask
+	{
+		TaskFunction task;
+		void *context;
+		uint32_t period, nextRun; // microseconds
+	};
+	BackgroundTask backgroundTasks[maxBackgroundTasks];
+	uint8_t numBackgroundTasks;
+
+	// Single-producer (audio interrupt), single-consumer (AudioWorker) job queue
+	struct PostedJob
+	{
+		TaskFunction task;
+		void *context;
+		uint32_t arg;
+	};
+	static constexpr uint32_t jobQueueSize = 16; // power of two
+	PostedJob jobQueue[jobQueueSize];
+	volatile uint32_t jobQueueHead, jobQueueTail; // free-running; written only by producer / consumer respectively
+
+	void RunBackgroundTasks();
 
 	// 19-bit CV outputs
-	static void OnCVPWMWrap()
+	// A DMA channel, paced by the CV PWM slice wrap, copies 11-bit levels from
+	// a small ring into the slice compare register, so the PWM runs with no
+	// CPU interrupts. BufferFull keeps the ring a few entries ahead of the DMA,
+	// filling it with first-order sigma-delta modulated levels.
+	static constexpr int cvRingBits = 3;
+	static constexpr int cvRingSize = 1 << cvRingBits;
+	static constexpr uint32_t cvRingLookahead = 3; // PWM wraps ~1.27 times per sample
+	alignas(cvRingSize * sizeof(uint32_t)) static uint32_t cvRing[cvRingSize];
+	static const uint32_t cvDMATransferCount;
+	uint8_t cv_dma, cv_ctrl_dma; // DMA ids
+	uint32_t cvRingPos; // next ring entry to be filled
+	int32_t cvError[2];
+	uint32_t cvLastValue[2];
+	uint32_t cvSettled; // entries written since CV outputs last changed
+
+	static uint32_t __not_in_flash_func(cvPWMWord)(uint32_t level1, uint32_t level2)
+	{
+		// Both CV outputs are on one PWM slice; the compare register holds
+		// channel A in the low half-word and channel B in the high half-word
+		return (level1 << (16 * (CV_OUT_1 & 1))) | (level2 << (16 * (CV_OUT_2 & 1)));
+	}
+	void UpdateCVOutputs();
+
+};
+
+
+/** \brief ComputerCard with ProcessSample called without virtual dispatch
+
+    Derive a card from ComputerCardT<Card> rather than ComputerCard to have the
+    audio interrupt call Card::ProcessSample directly. The compiler can then
+    inline the card's DSP into the interrupt handler, rather than making an
+    indirect call through the vtable.
+
+    The interrupt handler needs access to ProcessSample, so a card that keeps
+    it protected should also declare `friend ComputerCardT;`
+*/
+template<class Derived>
+class ComputerCardT : public ComputerCard
+{
+public:
+	explicit ComputerCardT(Role role = Standalone) : ComputerCard(role) {}
+
+	/// Start audio processing, as ComputerCard::Run
+	void Run()
+	{
+		ComputerCard::thisptr = this;
+		AudioWorker(ComputerCardT::AudioCallback);
+	}
+
+private:
+	static void __not_in_flash_func(AudioCallback)()
+	{
+		Derived *card = static_cast<Derived *>(static_cast<ComputerCardT *>(thisptr));
+		card->CollectInputs();
+		card->Derived::ProcessSample();
+		card->SendOutputs();
+	}
+};
+
+
+/** \brief Circular delay line with interpolated reads, in storage it doesn't own
+
+    Linear interpolation between adjacent samples uses INTERP0 in blend mode,
+    as configured by ComputerCard::ConfigureInterpolators, so reads must
+    happen on the core running the audio interrupt (i.e. from ProcessSample),
+    or on another core that has called ConfigureInterpolators itself.
+
+    Read positions are wrapped without division: by masking for power-of-two
+    sizes, otherwise by a single compare. One extra sample at the end of the
+    storage mirrors the first, so the two samples of a read are always adjacent.
+
+    The Size + 1 samples of storage are passed to the constructor, so that short
+    delay lines can be carved from one allocation, such as the buffer of a long
+    InterpDelayLine while it is not in use. Each region's storage must not
+    overlap another's while both are in use.
+*/
+template<int Size>
+class DelayRegion
+{
+public:
+	explicit DelayRegion(int16_t *storage) : buffer(storage), writeIndex(0) {}
+
+	/// Zero the region's samples
+	void Clear()
+	{
+		for (int i = 0; i <= Size; i++)
+		{
+			buffer[i] = 0;
+		}
+	}
+
+	/// Write sample at the current write position
+	void __not_in_flash_func(Write)(int16_t val)
+	{
+		buffer[writeIndex] = val;
+		if (writeIndex == 0) buffer[Size] = val;
+	}
+
+	/// Move the write position on by one sample
+	void __not_in_flash_func(Advance)()
+	{
+		if (isPow2)
+		{
+			writeIndex = (writeIndex + 1) & (Size - 1);
+		}
+		else
+		{
+			writeIndex++;
+			if (writeIndex == Size) writeIndex = 0;
+		}
+	}
+
+	/// Return the current write position (0 to Size-1)
+	int32_t __not_in_flash_func(WriteIndex)() const {return writeIndex;}
+
+	/// Return sample at index (-Size+1 to 2*Size-1, wrapped to the buffer),
+	/// blended towards sample at index-1 by frac (0-255)
+	int32_t __not_in_flash_func(ReadAt)(int32_t index, int32_t frac) const
+	{
+		int32_t pos = wrap(index - 1);
+		interp0->accum[1] = frac;
+		interp0->base[0] = buffer[pos + 1];
+		interp0->base[1] = buffer[pos];
+		return (int32_t)interp0->peek[1];
+	}
+
+	/// Return sample delay (0 to Size-1) samples before the write position,
+	/// blended towards the sample before it by frac (0-255)
+	int32_t __not_in_flash_func(Read)(int32_t delay, int32_t frac) const
+	{
+		return ReadAt(writeIndex - delay, frac);
+	}
+
+	/// As ReadAt, with a 16-bit frac (0-65535), for slowly moving reads where
+	/// 8 bits would step audibly. One multiply instead of INTERP0. Rounded to
+	/// the nearest sample value, so that a read in a feedback loop adds no DC.
+	int32_t __not_in_flash_func(ReadAtFine)(int32_t index, int32_t frac) const
+	{
+		int32_t pos = wrap(index - 1);
+		int32_t a = buffer[pos + 1];
+		return a + (((buffer[pos] - a) * frac + 32768) >> 16);
+	}
+
+private:
+	static constexpr bool isPow2 = (Size & (Size - 1)) == 0;
+
+	static int32_t __not_in_flash_func(wrap)(int32_t pos)
+	{
+		if (isPow2) return pos & (Size - 1);
+		if (pos < 0) return pos + Size;
+		if (pos >= Size) return pos - Size;
+		return pos;
+	}
+
+	int16_t *buffer; // Size + 1 samples: buffer[Size] mirrors buffer[0]
+	int32_t writeIndex;
+};
+
+
+/** \brief Circular delay line with interpolated reads, owning its buffer
+
+    A DelayRegion over a buffer of its own, zeroed on construction. Spare
+    samples after the delay line's are part of the same buffer but never
+    written by it, for short lines (DelayRegion, AllpassChain) that run
+    alongside it.
+*/
+template<int Size, int Spare = 0>
+class InterpDelayLine : public DelayRegion<Size>
+{
+public:
+	InterpDelayLine() : DelayRegion<Size>(buffer)
+	{
+		for (int i = 0; i <= Size + Spare; i++)
+		{
+			buffer[i] = 0;
+		}
+	}
+
+	/// The buffer, Size + 1 samples, for a mode that doesn't use the delay line
+	/// to carve a DelayRegion from
+	int16_t *Storage() {return buffer;}
+
+	/// The Spare samples after the delay line's, free to use alongside it
+	int16_t *SpareStorage() {return buffer + Size + 1;}
+
+private:
+	int16_t buffer[Size + 1 + Spare]; // buffer[Size] mirrors buffer[0]
+};
+
+
+/** \brief Lookup table filled at compile time
+
+    MakeTable fills a table from a constexpr function of the index, so a table
+    is generated from its formula rather than pasted in, and its size and
+    resolution are template arguments:
+
+        static constexpr auto curve = MakeTable<int16_t, 256>([](int i) { ... });
+
+    TableMath has constexpr versions of the functions the generators need, as
+    the <cmath> ones can't be evaluated at compile time. A table declared
+    static constexpr is placed in flash, like a const array.
+*/
+template<typename T, int Size>
+struct LookupTable
+{
+	static constexpr int size = Size;
+	T values[Size];
+
+	constexpr const T &operator[](int index) const {return values[index];}
+};
+
+template<typename T, int Size, typename F>
+constexpr LookupTable<T, Size> MakeTable(F f)
+{
+	LookupTable<T, Size> table{};
+	for (int i = 0; i < Size; i++)
+	{
+		table.values[i] = f(i);
+	}
+	return table;
+}
+
+namespace TableMath
+{
+	constexpr double pi = 3.14159265358979323846;
+	constexpr double ln2 = 0.69314718055994530942;
+
+	constexpr int32_t Round(double x) {return (int32_t)(x < 0 ? x - 0.5 : x + 0.5);}
+
+	/// e^x, for |x| up to about 40
+	constexpr double Exp(double x)
+	{
+		// Halve x until small, sum the Taylor series, then square back up
+		int halvings = 0;
+		while (x > 0.5 || x < -0.5)
+		{
+			x *= 0.5;
+			halvings++;
+		}
+		double sum = 1, term = 1;
+		for (int n = 1; n < 20; n++)
+		{
+			term *= x / n;
+			sum += term;
+		}
+		for (int i = 0; i < halvings; i++)
+		{
+			sum *= sum;
+		}
+		return sum;
+	}
+
+	constexpr double Exp2(double x) {return Exp(x * ln2);}
+
+	constexpr double Sin(double x)
+	{
+		// Reduce to -pi to pi, then Taylor series
+		while (x > pi) x -= 2 * pi;
+		while (x < -pi) x += 2 * pi;
+		double sum = 0, term = x;
+		for (int n = 1; n < 40; n += 2)
+		{
+			sum += term;
+			term *= -x * x / ((n + 1) * (n + 2));
+		}
+		return sum;
+	}
+
+	constexpr double Cos(double x) {return Sin(x + pi / 2);}
+
+	constexpr double Tanh(double x)
+	{
+		if (x > 20) return 1;
+		if (x < -20) return -1;
+		double e = Exp(2 * x);
+		return (e - 1) / (e + 1);
+	}
+
+	/// The smallest prime at least n, for delay lengths whose echoes don't coincide
+	constexpr int32_t NextPrime(int32_t n)
+	{
+		if (n <= 2) return 2;
+		for (;; n++)
+		{
+			bool prime = true;
+			for (int32_t d = 2; d * d <= n; d++)
+			{
+				if (n % d == 0)
+				{
+					prime = false;
+					break;
+				}
+			}
+			if (prime) return n;
+		}
+	}
+}
+
+/// Exponential pitch: one octave of periods (delay lengths) in Size steps,
+/// from start down to half of it. entry i = start / 2^(i/Size), rounded.
+template<int Size>
+constexpr LookupTable<uint32_t, Size> ExpPeriodTable(uint32_t start)
+{
+	return MakeTable<uint32_t, Size>([start](int i) {
+		return (uint32_t)TableMath::Round(start / TableMath::Exp2((double)i / Size));
+	});
+}
+
+/// Equal-power crossfade: the gain (0 to 2^Bits - 1) of the incoming signal at
+/// position i of Size. The outgoing signal's gain is entry Size-1-i.
+template<int Size, int Bits>
+constexpr LookupTable<int32_t, Size> EqualPowerTable()
+{
+	return MakeTable<int32_t, Size>([](int i) {
+		return TableMath::Round(((1 << Bits) - 1) * TableMath::Sin(TableMath::pi / 2 * i / (Size - 1)));
+	});
+}
+
+/// Hann window of Size points (periodic), scaled to 0 to 2^Bits - 1
+template<int Size, int Bits>
+constexpr LookupTable<int32_t, Size> HannTable()
+{
+	return MakeTable<int32_t, Size>([](int i) {
+		return TableMath::Round(((1 << Bits) - 1) * (0.5 - 0.5 * TableMath::Cos(2 * TableMath::pi * i / Size)));
+	});
+}
+
+/// Tanh saturation, for inputs 0 to inputMax in Size steps (entry i is input
+/// i * inputMax / (Size-1)), with outputs approaching outputMax. Odd symmetric,
+/// so negative inputs use the negated entry of their magnitude.
+template<int Size>
+constexpr LookupTable<int16_t, Size> TanhTable(int32_t inputMax, int32_t outputMax)
+{
+	return MakeTable<int16_t, Size>([inputMax, outputMax](int i) {
+		double x = (double)i * inputMax / (Size - 1);
+		return (int16_t)TableMath::Round(outputMax * TableMath::Tanh(x / outputMax));
+	});
+}
+
+
+/** \brief Signed fixed-point number with IntBits integer and FracBits fractional bits
+
+    Held in an int32_t, so IntBits + FracBits is at most 31 (the sign takes the
+    last bit). Formats used by the cards include:
+        Fixed<11, 0>   12-bit audio and CV samples
+        Fixed<0, 12>   gains on the 0-4095 scale, applied with (x * gain + 2048) >> 12
+        Fixed<0, 16>   one-pole filter coefficients
+        Fixed<17, 7>   delay times in samples, with 7 fractional bits
+
+    a * b gives the exact product, in the format with the bits of both plus an
+    integer bit (for the most negative times the most negative). It doesn't
+    compile if that needs more than 32 bits, so a 64-bit multiply (a
+    library call on the Cortex-M0+) is never made by accident. Multiply<I, F>
+    rounds a product to a chosen format, with a 32-bit intermediate if the exact
+    product fits, otherwise a 64-bit one. Round and Truncate change format.
+
+    Each operation compiles to the plain integer arithmetic it replaces. In host
+    builds, values outside their format abort with a message (host_fixed_overflow).
+*/
+template<int IntBits, int FracBits>
+class Fixed
+{
+	static_assert(IntBits >= 0 && FracBits >= 0 && IntBits + FracBits <= 31, "Fixed needs at most 31 bits plus sign");
+
+public:
+	static constexpr int intBits = IntBits;
+	static constexpr int fracBits = FracBits;
+	static constexpr int32_t maxRaw = (int32_t)(((int64_t)1 << (IntBits + FracBits)) - 1);
+	static constexpr int32_t minRaw = -maxRaw - 1;
+
+	constexpr Fixed() : raw(0) {}
+
+	/// From the integer holding the value scaled by 2^FracBits
+	static constexpr Fixed FromRaw(int64_t raw)
+	{
+		Fixed f;
+		f.raw = Checked(raw);
+		return f;
+	}
+
+	/// From an integer value
+	static constexpr Fixed FromInt(int32_t value) {return FromRaw((int64_t)value << FracBits);}
+
+	/// The value scaled by 2^FracBits
+	constexpr int32_t Raw() const {return raw;}
+
+	/// Integer part (rounded down), e.g. the whole samples of a delay time
+	constexpr int32_t Int() const {return raw >> FracBits;}
+
+	/// Fractional part, 0 to 2^FracBits - 1
+	constexpr int32_t Frac() const {return raw & ((1 << FracBits) - 1);}
+
+	/// Change format, rounding to nearest if fractional bits are dropped
+	template<int I, int F>
+	constexpr Fixed<I, F> Round() const
+	{
+		if constexpr (F >= FracBits) return Fixed<I, F>::FromRaw((int64_t)raw << (F - FracBits));
+		else return Fixed<I, F>::FromRaw((raw + (1 << (FracBits - F - 1))) >> (FracBits - F));
+	}
+
+	/// Change format, rounding down if fractional bits are dropped
+	template<int I, int F>
+	constexpr Fixed<I, F> Truncate() const
+	{
+		if constexpr (F >= FracBits) return Fixed<I, F>::FromRaw((int64_t)raw << (F - FracBits));
+		else return Fixed<I, F>::FromRaw(raw >> (FracBits - F));
+	}
+
+	constexpr Fixed operator+(Fixed b) const {return FromRaw((int64_t)raw + b.raw);}
+	constexpr Fixed operator-(Fixed b) const {return FromRaw((int64_t)raw - b.raw);}
+	constexpr Fixed operator-() const {return FromRaw(-(int64_t)raw);}
+	constexpr Fixed &operator+=(Fixed b) {return *this = *this + b;}
+	constexpr Fixed &operator-=(Fixed b) {return *this = *this - b;}
+
+	constexpr bool operator<(Fixed b) const {return raw < b.raw;}
+	constexpr bool operator>(Fixed b) const {return raw > b.raw;}
+	constexpr bool operator<=(Fixed b) const {return raw <= b.raw;}
+	constexpr bool operator>=(Fixed b) const {return raw >= b.raw;}
+	constexpr bool operator==(Fixed b) const {return raw == b.raw;}
+	constexpr bool operator!=(Fixed b) const {return raw != b.raw;}
+
+	/// Exact product, with a 32-bit multiply
+	template<int I2, int F2>
+	constexpr Fixed<IntBits + I2 + 1, FracBits + F2> operator*(Fixed<I2, F2> b) const
 	{
-		static int32_t error1 = 0, error2 = 0;
+		static_assert(IntBits + I2 + 1 + FracBits + F2 <= 31,
+			"product needs a 64-bit multiply: use Multiply<I, F> to round it to a format explicitly");
+		return Fixed<IntBits + I2 + 1, FracBits + F2>::FromRaw(Product(raw, b.Raw()));
+	}
+
+private:
+	int32_t raw;
 
-		pwm_clear_irq(pwm_gpio_to_slice_num(CV_OUT_1)); // clear the interrupt flag
-		uint32_t truncated_cv1_val = (cvValue[0]-error1) & 0xFFFFFF00;
-		error1 += truncated_cv1_val - cvValue[0];
-		pwm_set_gpio_level(CV_OUT_1, (truncated_cv1_val>>8));
-		uint32_t truncated_cv2_val = (cvValue[1]-error2) & 0xFFFFFF00;
-		error2 += truncated_cv2_val - cvValue[1];
-		pwm_set_gpio_level(CV_OUT_2, (truncated_cv2_val>>8));
+	static constexpr int32_t Checked(int64_t value)
+	{
+#ifdef PICO_HOST_H
+		if (value > maxRaw || value < minRaw) host_fixed_overflow(value, IntBits, FracBits);
+#endif
+		return (int32_t)value;
 	}
 
+	// The exact product is checked against its format in host builds, so is formed in 64 bits there
+	static constexpr int64_t Product(int32_t a, int32_t b)
+	{
+#ifdef PICO_HOST_H
+		return (int64_t)a * b;
+#else
+		return a * b;
+#endif
+	}
+};
+
+/// a * b rounded to Fixed<I, F>: a 32-bit multiply if the exact product fits, otherwise 64-bit
+template<int I, int F, int I1, int F1, int I2, int F2>
+constexpr Fixed<I, F> Multiply(Fixed<I1, F1> a, Fixed<I2, F2> b)
+{
+	static_assert(F <= F1 + F2, "Multiply only drops fractional bits");
+	constexpr int shift = F1 + F2 - F;
+	constexpr int32_t half = shift > 0 ? (int32_t)1 << (shift - 1) : 0;
+	if constexpr (I1 + I2 + 1 + F1 + F2 <= 31)
+	{
+		return Fixed<I, F>::FromRaw((a.Raw() * b.Raw() + half) >> shift);
+	}
+	else
+	{
+		return Fixed<I, F>::FromRaw(((int64_t)a.Raw() * b.Raw() + half) >> shift);
+	}
+}
+
+
+/** \brief Equal-power dry/wet mixer
+
+    Gains follow the quarter sine and cosine, so the total power stays
+    constant across the mix: halfway, dry and wet are each -3dB, rather than
+    the -6dB of a linear crossfade. SetMix looks the gains up in an
+    EqualPowerTable (interpolated between its 257 points), and only when the
+    mix has changed, so it can be called every sample with a knob value.
+    Mix then costs one multiply for the dry signal, shared by both channels,
+    and one per wet channel.
+
+    The gains are Fixed<0, 12>, and Mix takes samples in any whole-number Fixed
+    format. Dry and wet gains sum to up to 1.41, so the mix has one more integer
+    bit than its inputs, for the card to clip.
+*/
+class EqualPowerMixer
+{
+public:
+	/// Gain, on the 0-4095 scale
+	using Gain = Fixed<0, 12>;
+
+	EqualPowerMixer() : mix(-1), dryGain(Gain::FromRaw(4095)), wetGain() {}
+
+	/// Set the mix, from 0 (dry) to 4095 (wet)
+	void __not_in_flash_func(SetMix)(int32_t newMix)
+	{
+		if (newMix == mix) return;
+		mix = newMix;
+		if (newMix < 0) newMix = 0;
+		if (newMix > 4095) newMix = 4095;
+		wetGain = Gain::FromRaw(lookup(newMix));
+		dryGain = Gain::FromRaw(lookup(4095 - newMix));
+	}
+
+	/// Mix dry with wetLeft and wetRight
+	template<int I>
+	void __not_in_flash_func(Mix)(Fixed<I, 0> dry, Fixed<I, 0> wetLeft, Fixed<I, 0> wetRight,
+		Fixed<I + 1, 0> &outLeft, Fixed<I + 1, 0> &outRight) const
+	{
+		Fixed<I + 1, 12> dryTerm = dry * dryGain;
+		outLeft = (dryTerm + wetLeft * wetGain).template Round<I + 1, 0>();
+		outRight = (dryTerm + wetRight * wetGain).template Round<I + 1, 0>();
+	}
+
+	/// Mix dry with wet, for one channel
+	template<int I>
+	Fixed<I + 1, 0> __not_in_flash_func(Mix)(Fixed<I, 0> dry, Fixed<I, 0> wet) const
+	{
+		return (dry * dryGain + wet * wetGain).template Round<I + 1, 0>();
+	}
+
+	Gain DryGain() const {return dryGain;}
+	Gain WetGain() const {return wetGain;}
+
+private:
+	static constexpr int curveBits = 8;
+	static constexpr auto curve = EqualPowerTable<(1 << curveBits) + 1, 12>();
+
+	// Gain at position 0-4095 along the curve: 16 positions between table points
+	static int32_t __not_in_flash_func(lookup)(int32_t position)
+	{
+		int32_t index = position >> 4;
+		int32_t frac = position & 15;
+		return curve[index] + (((curve[index + 1] - curve[index]) * frac + 8) >> 4);
+	}
+
+	int32_t mix;
+	Gain dryGain;
+	Gain wetGain;
+};
+
+
+/** \brief State-variable filter (Chamberlin), lowpass, bandpass and highpass at once
+
+    Two multiplies per sample, plus one when reading High. The cutoff is set by
+    a coefficient, 2 sin(pi * cutoff / 48000) scaled by 2^14, best looked up at
+    control rate from a table of Coefficient(hz) values. The filter is stable
+    for cutoffs up to about 7kHz. Damping is fixed at 1.4375 (Q = 0.7), so no
+    output rises above 0dB, and the filter can sit in a feedback loop. High is
+    scaled by 1 - f^2/4 - f*damping/2, which cancels the gain this filter
+    structure otherwise adds above the cutoff. Samples are 12-bit; the state
+    holds 3 extra fractional bits.
+*/
+class StateVariableFilter
+{
+public:
+	StateVariableFilter() : cutoff(0), highGain(1 << 14), low(0), band(0), high(0) {}
+
+	/// Cutoff coefficient for a frequency in Hz, for constexpr tables
+	static constexpr int32_t Coefficient(double hz)
+	{
+		return TableMath::Round(2 * TableMath::Sin(TableMath::pi * hz / 48000) * (1 << 14));
+	}
+
+	void SetCutoff(int32_t coefficient)
+	{
+		cutoff = coefficient;
+		highGain = (1 << 14) - ((coefficient * coefficient) >> 16) - ((coefficient * 23) >> 5);
+	}
+
+	/// Filter one sample; then read the outputs with Low, Band and High
+	void __not_in_flash_func(Process)(int32_t in)
+	{
+		low += (cutoff * band + 8192) >> 14;
+		high = (in << 3) - low - band - (band >> 2) - (band >> 3) - (band >> 4);
+		band += (cutoff * high + 8192) >> 14;
+	}
+
+	int32_t Low() const {return low >> 3;}
+	int32_t Band() const {return band >> 3;}
+	int32_t __not_in_flash_func(High)() const {return ((high >> 3) * highGain + 8192) >> 14;}
+
+	void Reset() {low = band = high = 0;}
+
+private:
+	int32_t cutoff;
+	int32_t highGain;
+	int32_t low, band, high;
+};
+
+
+/** \brief Chain of Schroeder allpass filters, in storage it doesn't own
+
+    Each stage is an allpass of its own length: flat in level, but smearing
+    transients into a dense run of echoes, as in the diffusers at the front of a
+    reverb. Stages are run in one loop, each costing two multiplies, one load
+    and one store, whatever its length. Lengths are set at construction; with
+    prime lengths (TableMath::NextPrime) the stages' echoes don't line up.
+    Storage is the sum of the lengths, as from InterpDelayLine::SpareStorage.
+    The gain (0-4095, for 0 to 1) sets the diffusion, and is the same for every
+    stage. Samples are 12-bit. Between stages, and in the lines, they carry 2
+    extra fractional bits, so that rounding noise stays below the 12-bit floor
+    when the chain sits in a feedback loop; the lines are clamped to 16 bits.
+*/
+template<int Stages>
+class AllpassChain
+{
+public:
+	AllpassChain(int16_t *storage, const int32_t (&lengths)[Stages], int32_t stageGain) : gain(stageGain)
+	{
+		for (int s = 0; s < Stages; s++)
+		{
+			stages[s].line = storage;
+			stages[s].length = lengths[s];
+			stages[s].pos = 0;
+			storage += lengths[s];
+		}
+	}
+
+	/// Storage needed for the stage lengths
+	static constexpr int32_t StorageSize(const int32_t (&lengths)[Stages])
+	{
+		int32_t total = 0;
+		for (int s = 0; s < Stages; s++) total += lengths[s];
+		return total;
+	}
+
+	void Clear()
+	{
+		for (int s = 0; s < Stages; s++)
+		{
+			for (int32_t i = 0; i < stages[s].length; i++) stages[s].line[i] = 0;
+		}
+	}
+
+	int32_t __not_in_flash_func(Process)(int32_t in)
+	{
+		int32_t x = in << 2;
+		for (int s = 0; s < Stages; s++)
+		{
+			Stage &stage = stages[s];
+			int32_t delayed = stage.line[stage.pos];
+			int32_t v = x - ((gain * delayed + 2048) >> 12);
+			if (v > 32767) v = 32767;
+			if (v < -32768) v = -32768;
+			x = delayed + ((gain * v + 2048) >> 12);
+			stage.line[stage.pos] = (int16_t)v;
+			if (++stage.pos == stage.length) stage.pos = 0;
+		}
+		return (x + 2) >> 2;
+	}
+
+private:
+	struct Stage
+	{
+		int16_t *line;
+		int32_t length;
+		int32_t pos;
+	};
+	Stage stages[Stages];
+	int32_t gain;
+};
+
+
+/** \brief Low-frequency oscillator, sine and triangle
+
+    A 32-bit phase accumulator, wrapping once per cycle, stepped by an
+    increment set from Increment(hz). Sine interpolates a 256-point table, so
+    it is smooth even at the slowest rates; Triangle is computed from the
+    phase. Both run from -32767 to 32767, starting at 0 and rising, and take
+    a phase offset (a quarter cycle is 1 << 30) so that one oscillator can
+    drive several taps in quadrature.
+*/
+class Lfo
+{
+public:
+	Lfo() : phase(0), increment(0) {}
+
+	/// Phase increment per sample for a frequency in Hz, for constexpr tables
+	static constexpr uint32_t Increment(double hz)
+	{
+		return (uint32_t)(hz * 4294967296.0 / 48000 + 0.5);
+	}
+
+	void SetIncrement(uint32_t newIncrement) {increment = newIncrement;}
+
+	/// Move on by one sample
+	void __not_in_flash_func(Step)() {phase += increment;}
+
+	void Reset() {phase = 0;}
+
+	int32_t __not_in_flash_func(Sine)(uint32_t offset = 0) const
+	{
+		uint32_t p = phase + offset;
+		int32_t index = p >> 24;
+		int32_t frac = (p >> 8) & 0xFFFF;
+		return sine[index] + (((sine[index + 1] - sine[index]) * frac) >> 16);
+	}
+
+	int32_t __not_in_flash_func(Triangle)(uint32_t offset = 0) const
+	{
+		// From the trough at a quarter cycle before phase 0, up over half a cycle, then down
+		int32_t x = (phase + offset + (1u << 30)) >> 16;
+		return (x < 32768) ? 2 * x - 32767 : 2 * (65535 - x) - 32767;
+	}
+
+private:
+	static constexpr auto sine = MakeTable<int16_t, 257>([](int i) {
+		return (int16_t)TableMath::Round(32767 * TableMath::Sin(2 * TableMath::pi * i / 256));
+	});
+
+	uint32_t phase;
+	uint32_t increment;
 };
 
 
@@ -427,8 +1447,14 @@ private:
 #include "hardware/dma.h"
 #include "hardware/flash.h"
 #include "hardware/i2c.h"
-#include "hardware/irq.h"
 #include "hardware/spi.h"
+#include "hardware/timer.h"
+#include "hardware/structs/systick.h"
+
+#ifdef COMPUTERCARD_TRACE_SIZE
+#include "pico/stdio.h"
+#include <cstdio>
+#endif
 
 // Input normalisation probe pin
 #define NORMALISATION_PROBE 4
@@ -473,6 +1499,11 @@ private:
 #define RUN_ADC_MODE_ADC_STOPPED 2
 #define RUN_ADC_MODE_REQUEST_ADC_RESTART 3
 
+// Control trace states
+#define TRACE_IDLE 0
+#define TRACE_RECORDING 1
+#define TRACE_FULL 2
+
 
 #define EEPROM_ADDR_ID 0
 #define EEPROM_ADDR_VERSION 2
@@ -483,13 +1514,34 @@ private:
 
 #define EEPROM_PAGE_ADDRESS 0x50
 
+// Flash offset of the sector holding the calibration cache; by default the last sector.
+// Define COMPUTERCARD_NO_CAL_CACHE to read calibration from EEPROM on every boot.
+#ifndef COMPUTERCARD_CAL_CACHE_OFFSET
+#define COMPUTERCARD_CAL_CACHE_OFFSET (PICO_FLASH_SIZE_BYTES - FLASH_SECTOR_SIZE)
+#endif
+#define CAL_CACHE_MAGIC 0x43414C31 // "CAL1"
+
 
 // Initialise CV output delta-sigma target to half-way (near 0V)
 volatile uint32_t ComputerCard::cvValue[2] = {262144,262144};
 
+// DMA ring of CV PWM levels (aligned in the declaration, for the DMA address wrap)
+uint32_t ComputerCard::cvRing[ComputerCard::cvRingSize];
+
+// Transfer count re-armed by the CV control DMA channel (~19 hours of PWM wraps)
+const uint32_t ComputerCard::cvDMATransferCount = 0xFFFFFFFF;
+
 
 ComputerCard *ComputerCard::thisptr;
 
+ComputerCard::PulseEdge ComputerCard::pulseEdges[2][ComputerCard::pulseEdgeQueueSize];
+volatile uint32_t ComputerCard::pulseEdgeHead[2];
+volatile uint32_t ComputerCard::pulseEdgeTail[2];
+
+#ifdef COMPUTERCARD_TRACE_SIZE
+uint8_t ComputerCard::traceBuffer[COMPUTERCARD_TRACE_SIZE];
+#endif
+
 // Return pseudo-random bit for normalisation probe
 uint32_t __not_in_flash_func(ComputerCard::next_norm_probe)()
 {
@@ -498,9 +1550,64 @@ uint32_t __not_in_flash_func(ComputerCard::next_norm_probe)()
 	return lcg_seed >> 31;
 }
 
+// Set up INTERP0 for InterpDelayLine:
+// lane 1 supplies an 8-bit alpha, and PEEK1 returns the signed blend BASE0 + alpha*(BASE1-BASE0)/256
+void __not_in_flash_func(ComputerCard::ConfigureInterpolators)()
+{
+	interp_config cfg = interp_default_config();
+	interp_config_set_blend(&cfg, true);
+	interp_set_config(interp0, 0, &cfg);
+
+	cfg = interp_default_config();
+	interp_config_set_signed(&cfg, true);
+	interp_config_set_mask(&cfg, 0, 7);
+	interp_set_config(interp0, 1, &cfg);
+}
+
+// Core 0 stack reservation, from the linker script
+extern uint32_t __StackBottom, __StackTop;
+
+#define STACK_PAINT 0x57ACC0DE
+
+void ComputerCard::PaintStack()
+{
+	// Paint from the bottom of the reservation to just below this function's frame
+	volatile uint32_t *p = &__StackBottom;
+	volatile uint32_t *end = (volatile uint32_t *) __builtin_frame_address(0) - 16;
+	while (p < end)
+	{
+		*p++ = STACK_PAINT;
+	}
+}
+
+uint32_t ComputerCard::StackHighWater()
+{
+	const volatile uint32_t *p = &__StackBottom;
+	while (p < &__StackTop && *p == STACK_PAINT)
+	{
+		p++;
+	}
+	return (&__StackTop - p) * sizeof(uint32_t);
+}
+
 // Main audio core function
-void __not_in_flash_func(ComputerCard::AudioWorker)()
+void __not_in_flash_func(ComputerCard::AudioWorker)(irq_handler_t callback)
 {
+	audioCallback = callback;
+	ConfigureInterpolators();
+	PaintStack();
+
+	// SysTick as a free-running 24-bit down-counter at the system clock, for load measurement.
+	// Quality drops if an interrupt takes over 85% of a sample period, and recovers below 50%.
+	systick_hw->rvr = 0x00FFFFFF;
+	systick_hw->csr = 0x5; // enable, processor clock, no interrupt
+	cyclesPerSample = clock_get_hz(clk_sys) / 48000;
+	loadHighCycles = cyclesPerSample * 85 / 100;
+	loadLowCycles = cyclesPerSample / 2;
+#ifdef ENABLE_UART_DEBUGGING
+	loadDebugPins = false;
+#endif
+
 
 	adc_select_input(0);
 	adc_set_round_robin(0b0001111U);
@@ -530,27 +1637,76 @@ void __not_in_flash_func(ComputerCard::AudioWorker)()
 	// Synchronise ADC DMA the ADC samples
 	channel_config_set_dreq(&adc_dmacfg, DREQ_ADC);
 
-	// Setup DMA for 8 ADC samples
-	dma_channel_configure(adc_dma, &adc_dmacfg, ADC_Buffer[dmaPhase], &adc_hw->fifo, 8, true);
+	if (audioRateCV)
+	{
+		// Two DMAs of 4 ADC samples each. The first chains to the second, so the ADC
+		// is read without a gap, and interrupts to switch the CV multiplexer mid-frame.
+		adc2_dma = dma_claim_unused_channel(true);
+		dma_channel_config adc2_dmacfg = adc_dmacfg;
+		channel_config_set_chain_to(&adc_dmacfg, adc2_dma);
+		dma_channel_configure(adc2_dma, &adc2_dmacfg, ADC_Buffer[dmaPhase] + 4, &adc_hw->fifo, 4, false);
+		dma_channel_configure(adc_dma, &adc_dmacfg, ADC_Buffer[dmaPhase], &adc_hw->fifo, 4, true);
+		adc_frame_dma = adc2_dma;
+
+		// Preempt the audio interrupt, so that the mux switches while ProcessSample runs
+		dma_channel_set_irq1_enabled(adc_dma, true);
+		irq_set_exclusive_handler(DMA_IRQ_1, CVMuxCallback);
+		irq_set_priority(DMA_IRQ_1, PICO_HIGHEST_IRQ_PRIORITY);
+		irq_set_enabled(DMA_IRQ_1, true);
+	}
+	else
+	{
+		// Setup DMA for 8 ADC samples
+		dma_channel_configure(adc_dma, &adc_dmacfg, ADC_Buffer[dmaPhase], &adc_hw->fifo, 8, true);
+		adc_frame_dma = adc_dma;
+	}
 
 	// Turn on IRQ for ADC DMA
-	dma_channel_set_irq0_enabled(adc_dma, true);
+	dma_channel_set_irq0_enabled(adc_frame_dma, true);
 
 	// Call buffer_full ISR when ADC DMA finished
 	irq_set_enabled(DMA_IRQ_0, true);
-	irq_set_exclusive_handler(DMA_IRQ_0, ComputerCard::AudioCallback);
+	irq_set_exclusive_handler(DMA_IRQ_0, audioCallback);
 
 
-	// Turn on IRQ for CV output PWM
+	// Set up DMA for CV output PWM
 	uint slice_num = pwm_gpio_to_slice_num(CV_OUT_1);
-	pwm_clear_irq(slice_num);
-	pwm_set_irq_enabled(slice_num, true);
-	
-	irq_set_exclusive_handler(PWM_IRQ_WRAP, ComputerCard::OnCVPWMWrap);
-	irq_set_priority(PWM_IRQ_WRAP, 255);
-	irq_set_enabled(PWM_IRQ_WRAP, true);
+	cv_dma = dma_claim_unused_channel(true);
+	cv_ctrl_dma = dma_claim_unused_channel(true);
+
+	cvRingPos = 0;
+	cvSettled = 0;
+	for (int i = 0; i < 2; i++)
+	{
+		cvError[i] = 0;
+		cvLastValue[i] = cvValue[i];
+	}
+	for (int i = 0; i < cvRingSize; i++)
+	{
+		cvRing[i] = cvPWMWord(cvValue[0] >> 8, cvValue[1] >> 8);
+	}
+
+	dma_channel_config cv_dmacfg, cv_ctrl_dmacfg;
+	cv_dmacfg = dma_channel_get_default_config(cv_dma);
+	cv_ctrl_dmacfg = dma_channel_get_default_config(cv_ctrl_dma);
+
+	// Reading around the ring into the PWM compare register, one word per PWM wrap
+	channel_config_set_transfer_data_size(&cv_dmacfg, DMA_SIZE_32);
+	channel_config_set_read_increment(&cv_dmacfg, true);
+	channel_config_set_write_increment(&cv_dmacfg, false);
+	channel_config_set_ring(&cv_dmacfg, false, cvRingBits + 2);
+	channel_config_set_dreq(&cv_dmacfg, DREQ_PWM_WRAP0 + slice_num);
+	channel_config_set_chain_to(&cv_dmacfg, cv_ctrl_dma);
+
+	// Control channel restarts the ring DMA if it ever runs to the end of its transfer count
+	channel_config_set_transfer_data_size(&cv_ctrl_dmacfg, DMA_SIZE_32);
+	channel_config_set_read_increment(&cv_ctrl_dmacfg, false);
+	channel_config_set_write_increment(&cv_ctrl_dmacfg, false);
+
+	dma_channel_configure(cv_ctrl_dma, &cv_ctrl_dmacfg, &dma_hw->ch[cv_dma].al1_transfer_count_trig, &cvDMATransferCount, 1, false);
+	dma_channel_configure(cv_dma, &cv_dmacfg, &pwm_hw->slice[slice_num].cc, cvRing, cvDMATransferCount, true);
+
 
-	
 	// Set up DMA for SPI
 	spi_dmacfg = dma_channel_get_default_config(spi_dma);
 	channel_config_set_transfer_data_size(&spi_dmacfg, DMA_SIZE_16);
@@ -561,6 +1717,30 @@ void __not_in_flash_func(ComputerCard::AudioWorker)()
 	// Set up DMA to transmit 2 samples to SPI
 	dma_channel_configure(spi_dma, &spi_dmacfg, &spi_get_hw(SPI_PORT)->dr, NULL, 2, false);
 
+#ifdef COMPUTERCARD_TRACE_SIZE
+	// Record the control trace from the first sample, and print it once full
+	traceState = TRACE_IDLE;
+	stdio_init_all();
+	AddBackgroundTask(DumpTraceTask, this, 5000000);
+#endif
+
+	// Set up pulse input edge capture
+	if (usePulseEdgeCapture)
+	{
+		for (int i = 0; i < 2; i++)
+		{
+			pulseEdgeHead[i] = 0;
+			pulseEdgeTail[i] = 0;
+		}
+		gpio_add_raw_irq_handler_masked((1u << PULSE_1_INPUT) | (1u << PULSE_2_INPUT), PulseEdgeIRQ);
+		gpio_set_irq_enabled(PULSE_1_INPUT, GPIO_IRQ_EDGE_RISE | GPIO_IRQ_EDGE_FALL, true);
+		gpio_set_irq_enabled(PULSE_2_INPUT, GPIO_IRQ_EDGE_RISE | GPIO_IRQ_EDGE_FALL, true);
+		// Preempt the audio interrupt, so that timestamps aren't delayed by ProcessSample
+		irq_set_priority(IO_IRQ_BANK0, PICO_HIGHEST_IRQ_PRIORITY);
+		irq_set_enabled(IO_IRQ_BANK0, true);
+	}
+
+	ledsByTask = true;
 	adc_run(true);
 
 	while (1)
@@ -570,7 +1750,8 @@ void __not_in_flash_func(ComputerCard::AudioWorker)()
 		{
 			runADCMode = RUN_ADC_MODE_RUNNING;
 
-			dma_hw->ints0 = 1u << adc_dma; // reset adc interrupt flag
+			dma_hw->ints0 = 1u << adc_frame_dma; // reset adc interrupt flag
+			if (audioRateCV) dma_channel_set_write_addr(adc2_dma, ADC_Buffer[dmaPhase] + 4, false);
 			dma_channel_set_write_addr(adc_dma, ADC_Buffer[dmaPhase], true); // start writing into new buffer
 			dma_channel_set_read_addr(spi_dma, SPI_Buffer[dmaPhase], true); // start reading from new buffer
 
@@ -581,14 +1762,381 @@ void __not_in_flash_func(ComputerCard::AudioWorker)()
 		}
 		else if (runADCMode == RUN_ADC_MODE_ADC_STOPPED)
 		{
-			// We can't remove the PWM IRQ from within the ADC IRQ callback, so we do it here instead.
-			irq_set_enabled(PWM_IRQ_WRAP, false);
-			pwm_clear_irq(pwm_gpio_to_slice_num(CV_OUT_1)); // reset CV PWM interrupt flag
-			irq_remove_handler(PWM_IRQ_WRAP, ComputerCard::OnCVPWMWrap);
+			// Stop CV output DMA, leaving the PWM at its last level.
+			// Abort the control channel first so that it can't restart the ring channel.
+			dma_channel_cleanup(cv_ctrl_dma);
+			dma_channel_cleanup(cv_dma);
+
+			if (usePulseEdgeCapture)
+			{
+				gpio_set_irq_enabled(PULSE_1_INPUT, GPIO_IRQ_EDGE_RISE | GPIO_IRQ_EDGE_FALL, false);
+				gpio_set_irq_enabled(PULSE_2_INPUT, GPIO_IRQ_EDGE_RISE | GPIO_IRQ_EDGE_FALL, false);
+				gpio_remove_raw_irq_handler_masked((1u << PULSE_1_INPUT) | (1u << PULSE_2_INPUT), PulseEdgeIRQ);
+			}
+
+			// LEDs set from now on are written at once
+			ledsByTask = false;
+			UpdateLedsTask(this, time_us_32());
 			break;
 		}
-		   
 
+		RunBackgroundTasks();
+
+		// Sleep until the next interrupt, which is at most one audio sample away.
+		// With interrupts disabled, an interrupt arriving after the checks below
+		// still wakes the WFI, and is handled once interrupts are restored.
+		uint32_t irq = save_and_disable_interrupts();
+		if ((runADCMode == RUN_ADC_MODE_RUNNING || runADCMode == RUN_ADC_MODE_REQUEST_ADC_STOP)
+			&& jobQueueHead == jobQueueTail)
+		{
+			__wfi();
+		}
+		restore_interrupts(irq);
+	}
+}
+
+bool ComputerCard::AddBackgroundTask(TaskFunction task, void *context, uint32_t periodMicroseconds)
+{
+	if (numBackgroundTasks >= maxBackgroundTasks) return false;
+
+	BackgroundTask &t = backgroundTasks[numBackgroundTasks++];
+	t.task = task;
+	t.context = context;
+	t.period = periodMicroseconds;
+	t.nextRun = time_us_32();
+	return true;
+}
+
+// Run jobs posted from the audio interrupt, then any background tasks that are due
+void ComputerCard::RunBackgroundTasks()
+{
+	uint32_t tail = jobQueueTail;
+	while (tail != jobQueueHead)
+	{
+		__dmb(); // read job only after seeing head move past it
+		PostedJob job = jobQueue[tail & (jobQueueSize - 1)];
+		jobQueueTail = ++tail;
+		job.task(job.context, job.arg);
+	}
+
+	uint32_t now = time_us_32();
+	for (int i = 0; i < numBackgroundTasks; i++)
+	{
+		BackgroundTask &t = backgroundTasks[i];
+		if ((int32_t)(now - t.nextRun) >= 0)
+		{
+			t.nextRun = now + t.period;
+			t.task(t.context, now);
+		}
+	}
+}
+
+// Write the LED levels set by ProcessSample to the PWM slices. Writing them here, rather than
+// in the interrupt, keeps the PWM register writes out of the audio interrupt, and a
+// level changed several times within a PWM period only reaches the LED once anyway.
+void ComputerCard::UpdateLedsTask(void *context, uint32_t)
+{
+	ComputerCard *card = (ComputerCard *)context;
+	for (int i = 0; i < numLeds; i++)
+	{
+		pwm_set_gpio_level(leds[i], card->ledLevels[i]);
+	}
+}
+
+// Top up the CV output DMA ring with sigma-delta modulated PWM levels
+void __not_in_flash_func(ComputerCard::UpdateCVOutputs)()
+{
+	uint32_t cv0 = cvValue[0], cv1 = cvValue[1];
+
+	if (cv0 != cvLastValue[0] || cv1 != cvLastValue[1])
+	{
+		cvLastValue[0] = cv0;
+		cvLastValue[1] = cv1;
+		cvSettled = 0;
+	}
+	// A steady value with no fractional part needs no dithering,
+	// so once the whole ring holds it there is nothing more to do.
+	// This is always the case for cards that don't use the CV outputs.
+	else if (cvSettled >= cvRingSize && !((cv0 | cv1) & 0xFF))
+	{
+		return;
+	}
+
+	uint32_t readPos = ((dma_hw->ch[cv_dma].read_addr - (uintptr_t)cvRing) >> 2) & (cvRingSize - 1);
+	uint32_t pending = (cvRingPos - readPos) & (cvRingSize - 1);
+
+	// If the DMA has overtaken us (e.g. after settling), restart just ahead of it
+	if (pending > cvRingLookahead)
+	{
+		cvRingPos = readPos;
+		pending = 0;
+	}
+
+	for (; pending < cvRingLookahead; pending++)
+	{
+		uint32_t truncated_cv1_val = (cv0 - cvError[0]) & 0xFFFFFF00;
+		cvError[0] += truncated_cv1_val - cv0;
+		uint32_t truncated_cv2_val = (cv1 - cvError[1]) & 0xFFFFFF00;
+		cvError[1] += truncated_cv2_val - cv1;
+
+		cvRing[cvRingPos] = cvPWMWord(truncated_cv1_val >> 8, truncated_cv2_val >> 8);
+		cvRingPos = (cvRingPos + 1) & (cvRingSize - 1);
+		cvSettled++;
+	}
+}
+
+// Switch the CV multiplexer at the middle of the ADC frame, with audio-rate CV
+void __not_in_flash_func(ComputerCard::CVMuxCallback)()
+{
+	dma_hw->ints1 = 1u << thisptr->adc_dma;
+	gpio_xor_mask(1u << MX_A);
+}
+
+// Timestamp edges on the pulse inputs
+void __not_in_flash_func(ComputerCard::PulseEdgeIRQ)()
+{
+	uint32_t now = timer_hw->timerawl;
+	for (int i = 0; i < 2; i++)
+	{
+		uint pin = PULSE_1_INPUT + i;
+		uint32_t events = gpio_get_irq_event_mask(pin) & (GPIO_IRQ_EDGE_RISE | GPIO_IRQ_EDGE_FALL);
+		if (!events) continue;
+		gpio_acknowledge_irq(pin, events);
+
+		// Inputs are inverted, so a falling GPIO edge is the start of a pulse.
+		// If both edges happened since the last interrupt, the current level gives their order.
+		bool rising[2];
+		int numEdges;
+		if (events == (GPIO_IRQ_EDGE_RISE | GPIO_IRQ_EDGE_FALL))
+		{
+			bool high = gpio_get(pin);
+			rising[0] = high;
+			rising[1] = !high;
+			numEdges = 2;
+		}
+		else
+		{
+			rising[0] = (events == GPIO_IRQ_EDGE_FALL);
+			numEdges = 1;
+		}
+
+		for (int e = 0; e < numEdges; e++)
+		{
+			uint32_t head = pulseEdgeHead[i];
+			if (head - pulseEdgeTail[i] >= pulseEdgeQueueSize) break; // full: drop newest
+			pulseEdges[i][head & (pulseEdgeQueueSize - 1)] = {now, rising[e]};
+			__dmb();
+			pulseEdgeHead[i] = head + 1;
+		}
+	}
+}
+
+int __not_in_flash_func(ComputerCard::PulseInEdges)(int i, PulseEdge *edges, int maxEdges)
+{
+	if (replayInputs)
+	{
+		int n = 0;
+		while (replayEdgePos[i] < replayInputs->numEdges[i] && n < maxEdges)
+		{
+			edges[n++] = replayInputs->edges[i][replayEdgePos[i]++];
+		}
+		return n;
+	}
+
+	uint32_t tail = pulseEdgeTail[i];
+	uint32_t head = pulseEdgeHead[i];
+	__dmb();
+
+	// With the normalisation probe, an unplugged input sees the probe signal
+	bool discard = useNormProbe && !connected[Input::Pulse1 + i];
+
+	int n = 0;
+	while (tail != head && n < maxEdges)
+	{
+		if (!discard)
+		{
+			edges[n++] = pulseEdges[i][tail & (pulseEdgeQueueSize - 1)];
+		}
+		tail++;
+	}
+	pulseEdgeTail[i] = tail;
+
+#ifdef COMPUTERCARD_TRACE_SIZE
+	if (traceState == TRACE_RECORDING)
+	{
+		uint32_t nominal = traceStartTime + TraceSampleTime(traceSamples);
+		for (int e = 0; e < n; e++)
+		{
+			int32_t offset = edges[e].time - nominal;
+			uint32_t zigzag = ((uint32_t)offset << 1) ^ (uint32_t)(offset >> 31);
+			TraceEntry(TracePulseEdge1 + i, (zigzag << 1) | edges[e].rising);
+		}
+	}
+#endif
+	return n;
+}
+
+#ifdef COMPUTERCARD_TRACE_SIZE
+// Add this sample's trace entries for any inputs that have changed
+void __not_in_flash_func(ComputerCard::RecordTrace)()
+{
+	if (traceState == TRACE_FULL) return;
+	if (traceState == TRACE_IDLE)
+	{
+		traceStartTime = sampleTime;
+		traceSamples = 0;
+		traceLastEntry = 0;
+		traceLength = 0;
+		for (int f = 0; f < numTraceFields; f++)
+		{
+			traceLast[f] = 0;
+		}
+		traceState = TRACE_RECORDING;
+	}
+	else
+	{
+		traceSamples++;
+	}
+	traceSampleStart = traceLength;
+
+	TraceValue(TraceKnobMain, knobs[Main]);
+	TraceValue(TraceKnobX, knobs[X]);
+	TraceValue(TraceKnobY, knobs[Y]);
+	TraceValue(TraceCV1, cv[0]);
+	TraceValue(TraceCV2, cv[1]);
+#ifdef COMPUTERCARD_TRACE_AUDIO
+	TraceValue(TraceAudio1, adcInL);
+	TraceValue(TraceAudio2, adcInR);
+#endif
+	TraceValue(TraceSwitch, switchVal);
+	TraceValue(TracePulse, pulse[0] | (pulse[1] << 1));
+	uint32_t connectedBits = 0;
+	for (int i = 0; i < 6; i++)
+	{
+		connectedBits |= connected[i] << i;
+	}
+	TraceValue(TraceConnected, connectedBits);
+	TraceValue(TraceQuality, quality);
+}
+
+void __not_in_flash_func(ComputerCard::TraceValue)(int field, int32_t value)
+{
+	int32_t last = traceLast[field];
+	if (value == last) return;
+	traceLast[field] = value;
+
+	if (field < TraceSwitch)
+	{
+		int32_t delta = value - last;
+		TraceEntry(field, ((uint32_t)delta << 1) ^ (uint32_t)(delta >> 31));
+	}
+	else
+	{
+		TraceEntry(field, value);
+	}
+}
+
+// Append one entry at the current sample. If the buffer overflows,
+// the trace ends with the previous sample.
+void __not_in_flash_func(ComputerCard::TraceEntry)(int field, uint32_t value)
+{
+	if (traceState != TRACE_RECORDING) return;
+
+	uint32_t dt = traceSamples - traceLastEntry;
+	traceLastEntry = traceSamples;
+	TraceByte((field << 4) | (dt < 15 ? dt : 15));
+	if (dt >= 15) TraceVarint(dt - 15);
+
+	if (field < TraceSwitch || field >= TracePulseEdge1)
+	{
+		TraceVarint(value);
+	}
+	else
+	{
+		TraceByte(value);
+	}
+
+	if (traceLength > COMPUTERCARD_TRACE_SIZE)
+	{
+		traceLength = traceSampleStart;
+		traceState = TRACE_FULL;
+	}
+}
+
+// Once the trace is full, print it as hex between TRACE and END lines. Repeats
+// every few seconds, so that a terminal can be connected after recording.
+// TRACE line: format version, samples, bytes, whether audio inputs are included
+void ComputerCard::DumpTraceTask(void *context, uint32_t)
+{
+	ComputerCard *card = (ComputerCard *) context;
+	if (card->traceState != TRACE_FULL) return;
+
+#ifdef COMPUTERCARD_TRACE_AUDIO
+	const int traceAudio = 1;
+#else
+	const int traceAudio = 0;
+#endif
+	printf("TRACE 1 %lu %lu %d\n", (unsigned long) card->traceSamples, (unsigned long) card->traceLength, traceAudio);
+	for (uint32_t i = 0; i < card->traceLength; i++)
+	{
+		printf("%02x", traceBuffer[i]);
+		if ((i & 31) == 31 || i + 1 == card->traceLength) printf("\n");
+	}
+	printf("END\n");
+}
+#endif
+
+void __not_in_flash_func(ComputerCard::ReplaySample)(const TraceInputs &inputs, int16_t audioOut[2], int32_t cvOut[2], bool pulseOut[2])
+{
+	// As CollectInputs, which ignores switch changes for the first few samples
+	if (replaySamples < 8) lastSwitchVal = inputs.switchVal;
+	replaySamples++;
+
+	// A replayed card is never Run, so stays detached
+	detached = true;
+	RunDetached(inputs, audioOut, cvOut, pulseOut);
+}
+
+void __not_in_flash_func(ComputerCard::ProcessEngineSample)(const TraceInputs &inputs, int16_t audioOut[2], int32_t cvOut[2], bool pulseOut[2])
+{
+	RunDetached(inputs, audioOut, cvOut, pulseOut);
+}
+
+// ProcessSample with the given inputs, rather than the hardware's, and its outputs kept in the card
+void __not_in_flash_func(ComputerCard::RunDetached)(const TraceInputs &inputs, int16_t audioOut[2], int32_t cvOut[2], bool pulseOut[2])
+{
+	for (int i = 0; i < 3; i++)
+	{
+		knobs[i] = inputs.knobs[i];
+	}
+	for (int i = 0; i < 2; i++)
+	{
+		cv[i] = inputs.cv[i];
+		last_pulse[i] = pulse[i];
+		pulse[i] = inputs.pulse[i];
+		replayEdgePos[i] = 0;
+	}
+	adcInL = inputs.audio[0];
+	adcInR = inputs.audio[1];
+	for (int i = 0; i < 6; i++)
+	{
+		connected[i] = inputs.connected[i];
+	}
+	switchVal = inputs.switchVal;
+	quality = inputs.quality;
+	sampleTime = inputs.sampleTime;
+
+	replayInputs = &inputs;
+	ProcessSample();
+	replayInputs = nullptr;
+
+	lastSwitchVal = switchVal;
+
+	for (int i = 0; i < 2; i++)
+	{
+		audioOut[i] = dacOut[i];
+		cvOut[i] = 262143 - (int32_t) replayCVValue[i];
+		if (pulseOut) pulseOut[i] = replayPulseOut[i];
 	}
 }
 
@@ -605,8 +2153,9 @@ void __not_in_flash_func(ComputerCard::CorrectADCDNL)(uint16_t &value) const
 	value = uint32_t(value * 520349) >> 19; // Multiply by factor that maps 0-4095 input into 0-4095 output
 }
 
-// Per-audio-sample ISR, called when two sets of ADC samples have been collected from all four inputs
-void __not_in_flash_func(ComputerCard::BufferFull)()
+// First half of the per-audio-sample ISR, called when two sets of ADC samples have been collected from all four inputs.
+// BufferFull (or ComputerCardT's static callback) runs CollectInputs, then ProcessSample, then SendOutputs.
+void __not_in_flash_func(ComputerCard::CollectInputs)()
 {
 	static int startupCounter = 8; // Decreases by 1 each sample, can do startup things when nonzero.
 	static int mux_state = 0;
@@ -615,39 +2164,56 @@ void __not_in_flash_func(ComputerCard::BufferFull)()
 	// Internal variables for IIR filters on knobs/cv
 	static volatile int32_t knobssm[4] = { 0, 0, 0, 0 };
 	static volatile int32_t cvsm[2] = { 0, 0 };
+
+	isrStartCycles = systick_hw->cvr;
+	if (loadDebugPins) gpio_put(DEBUG_1, true);
+
+	sampleTime = timer_hw->timerawl;
+
 	__attribute__((unused)) static int np = 0, np1 = 0, np2 = 0;
 
 	adc_select_input(0);
 
 	// Advance external mux to next state
+	// With audio-rate CV, MX_A starts the frame inverted, and CVMuxCallback restores it mid-frame
 	int next_mux_state = (mux_state + 1) & 0x3;
-	gpio_put(MX_A, next_mux_state & 1);
+	gpio_put(MX_A, (next_mux_state & 1) ^ audioRateCV);
 	gpio_put(MX_B, next_mux_state & 2);
 
 	// Set up new writes into next buffer
-	uint8_t cpuPhase = dmaPhase;
+	cpuPhase = dmaPhase;
 	dmaPhase = 1 - dmaPhase;
 
-	dma_hw->ints0 = 1u << adc_dma; // reset adc interrupt flag
+	dma_hw->ints0 = 1u << adc_frame_dma; // reset adc interrupt flag
+	if (audioRateCV) dma_channel_set_write_addr(adc2_dma, ADC_Buffer[dmaPhase] + 4, false);
 	dma_channel_set_write_addr(adc_dma, ADC_Buffer[dmaPhase], true); // start writing into new buffer
 	dma_channel_set_read_addr(spi_dma, SPI_Buffer[dmaPhase], true); // start reading from new buffer
 
 	////////////////////////////////////////
 	// Collect various inputs and put them in variables for the DSP
 
-	// Set CV inputs, with ~240Hz LPF on CV input
+	// Set CV inputs, with LPF (by default ~240Hz) on CV input
 	int cvi = mux_state % 2;
 
 	// Compensation of ADC DNL errors.
 	CorrectADCDNL(ADC_Buffer[cpuPhase][7]); // CV inputs
+	if (audioRateCV) CorrectADCDNL(ADC_Buffer[cpuPhase][3]);
 	CorrectADCDNL(ADC_Buffer[cpuPhase][0]); // Audio inputs
 	CorrectADCDNL(ADC_Buffer[cpuPhase][4]);
 	CorrectADCDNL(ADC_Buffer[cpuPhase][1]);
 	CorrectADCDNL(ADC_Buffer[cpuPhase][5]);
 	
-	cvsm[cvi] = (15 * (cvsm[cvi]) + 16 * ADC_Buffer[cpuPhase][7]) >> 4;
+	cvsm[cvi] += (16 * ADC_Buffer[cpuPhase][7] - cvsm[cvi]) >> cvSmoothing;
 	cv[cvi] = 2048 - (cvsm[cvi] >> 4);
 
+	if (audioRateCV)
+	{
+		// The other CV input was sampled in the first half of the frame
+		int cvo = 1 - cvi;
+		cvsm[cvo] += (16 * ADC_Buffer[cpuPhase][3] - cvsm[cvo]) >> cvSmoothing;
+		cv[cvo] = 2048 - (cvsm[cvo] >> 4);
+	}
+
 
 	// Set audio inputs, by averaging the two samples collected.
 	// Invert to counteract inverting op-amp input configuration
@@ -689,8 +2255,16 @@ void __not_in_flash_func(ComputerCard::BufferFull)()
 			np = (np<<1)+(normprobe&0x1);
 		}
 
-		// CV sampled at 24kHz comes in over two successive samples
-		if (norm_probe_count == 14 || norm_probe_count == 15)
+		// CV sampled at 24kHz comes in over two successive samples, or at 48kHz in one
+		if (audioRateCV)
+		{
+			if (norm_probe_count == 15)
+			{
+				plug_state[2+cvi] = (plug_state[2+cvi]<<1)+(ADC_Buffer[cpuPhase][7]<1800);
+				plug_state[3-cvi] = (plug_state[3-cvi]<<1)+(ADC_Buffer[cpuPhase][3]<1800);
+			}
+		}
+		else if (norm_probe_count == 14 || norm_probe_count == 15)
 		{
 			plug_state[2+cvi] = (plug_state[2+cvi]<<1)+(ADC_Buffer[cpuPhase][7]<1800);
 		}
@@ -718,20 +2292,48 @@ void __not_in_flash_func(ComputerCard::BufferFull)()
 		if (Disconnected(Input::Pulse2)) pulse[1] = 0;
 	}
 	
+	// These were updated at the end of the ISR, after ProcessSample, when it was one function.
+	// They are local to CollectInputs and read only at its next call, and the mux and probe
+	// GPIOs are still set at the start of the ISR, so updating them here changes nothing
+	// the hardware or ProcessSample sees. lastSwitchVal, which SwitchChanged reads, is still
+	// updated after ProcessSample, in SendOutputs.
+	mux_state = next_mux_state;
+
+	norm_probe_count = (norm_probe_count + 1) & 0xF;
+
+	if (startupCounter) startupCounter--;
+
+#ifdef COMPUTERCARD_TRACE_SIZE
+	RecordTrace();
+#endif
+
 	////////////////////////////////////////
-	// Run the DSP
-	ProcessSample();
+	// Get ready to run the DSP
+	if (preserveInterp)
+	{
+		interp_save(interp0_hw, &interpSave);
+		ConfigureInterpolators();
+	}
+}
+
+// Second half of the per-audio-sample ISR, called after ProcessSample
+void __not_in_flash_func(ComputerCard::SendOutputs)()
+{
+	if (preserveInterp)
+	{
+		interp_restore(interp0_hw, &interpSave);
+	}
 
 	////////////////////////////////////////
 	// Collect DSP outputs and put them in the DAC SPI buffer
-	// CV/Pulse outputs are done immediately in ProcessSample
+	// Pulse outputs are done immediately in ProcessSample
+
+	UpdateCVOutputs();
 
 	// Invert dacout to counteract inverting output configuration
 	SPI_Buffer[cpuPhase][0] = dacval(-dacOut[0], DAC_CHANNEL_A);
 	SPI_Buffer[cpuPhase][1] = dacval(-dacOut[1], DAC_CHANNEL_B);
 
-	mux_state = next_mux_state;
-
 	// If Abort called, stop ADC and DMA
 	if (runADCMode == RUN_ADC_MODE_REQUEST_ADC_STOP)
 	{
@@ -739,22 +2341,62 @@ void __not_in_flash_func(ComputerCard::BufferFull)()
 		adc_set_round_robin(0);
 		adc_select_input(0);
 
-		dma_hw->ints0 = 1u << adc_dma; // reset adc interrupt flag
+		dma_hw->ints0 = 1u << adc_frame_dma; // reset adc interrupt flag
 		dma_channel_cleanup(adc_dma);
 		dma_channel_cleanup(spi_dma);
 		irq_set_enabled(DMA_IRQ_0, false);
-		irq_remove_handler(DMA_IRQ_0, ComputerCard::AudioCallback);
+		irq_remove_handler(DMA_IRQ_0, audioCallback);
+		if (audioRateCV)
+		{
+			dma_channel_cleanup(adc2_dma);
+			irq_set_enabled(DMA_IRQ_1, false);
+			irq_remove_handler(DMA_IRQ_1, CVMuxCallback);
+		}
 
 
 		
 		runADCMode = RUN_ADC_MODE_ADC_STOPPED;
 	}
 
-	norm_probe_count = (norm_probe_count + 1) & 0xF;
-
 	lastSwitchVal = switchVal;
-	
-	if (startupCounter) startupCounter--;
+
+	////////////////////////////////////////
+	// Measure interrupt load, from the start of CollectInputs
+
+	uint32_t cycles = (isrStartCycles - systick_hw->cvr) & 0x00FFFFFF;
+	if (cycles > blockPeakCycles) blockPeakCycles = cycles;
+	if (++loadBlockCount == loadBlockSize) UpdateQuality();
+
+	if (loadDebugPins) gpio_put(DEBUG_1, false);
+}
+
+// Once per block, step quality level down on high peak load,
+// or up after the load has been low for qualityRecoverBlocks blocks
+void __not_in_flash_func(ComputerCard::UpdateQuality)()
+{
+	if (blockPeakCycles > loadHighCycles)
+	{
+		if (quality != Minimal) quality = static_cast<Quality>(quality + 1);
+		lowLoadBlocks = 0;
+	}
+	else if (blockPeakCycles < loadLowCycles)
+	{
+		if (++lowLoadBlocks >= qualityRecoverBlocks)
+		{
+			if (quality != Full) quality = static_cast<Quality>(quality - 1);
+			lowLoadBlocks = 0;
+		}
+	}
+	else
+	{
+		lowLoadBlocks = 0;
+	}
+
+	if (loadDebugPins) gpio_put(DEBUG_2, quality != Full);
+
+	lastBlockPeakCycles = blockPeakCycles;
+	blockPeakCycles = 0;
+	loadBlockCount = 0;
 }
 
 ComputerCard::HardwareVersion_t ComputerCard::ProbeHardwareVersion()
@@ -796,19 +2438,54 @@ ComputerCard::HardwareVersion_t ComputerCard::ProbeHardwareVersion()
 	}
 }
 
-ComputerCard::ComputerCard()
+ComputerCard::ComputerCard(Role role)
 {
 	runADCMode = RUN_ADC_MODE_RUNNING;
 
-	adc_run(false);
-	adc_select_input(0);
-
-
 	useNormProbe = false;
+	usePulseEdgeCapture = false;
+	loadDebugPins = false;
+	cyclesPerSample = 0;
+	blockPeakCycles = 0;
+	lastBlockPeakCycles = 0;
+	loadBlockCount = 0;
+	lowLoadBlocks = 0;
+	quality = Full;
+	audioRateCV = false;
+	cvSmoothing = 4;
+	sampleTime = 0;
+	replayInputs = nullptr;
+	replaySamples = 0;
+	for (int i = 0; i < 2; i++)
+	{
+		replayCVValue[i] = 262144;
+		replayPulseOut[i] = false;
+	}
+	for (int i = 0; i < numLeds; i++)
+	{
+		ledLevels[i] = 0;
+	}
+	ledsByTask = false;
+	detached = (role == Engine);
+	preserveInterp = false;
+	numBackgroundTasks = 0;
+	jobQueueHead = 0;
+	jobQueueTail = 0;
 	for (int i=0; i<6; i++)
 	{
 		connected[i] = false;
 	}
+	hw = Unknown;
+	cvOutsCalibrated = false;
+	uniqueID = 0;
+
+	// An engine is run by another card, which has set up the hardware
+	if (role == Engine) return;
+
+	adc_run(false);
+	adc_select_input(0);
+
+	AddBackgroundTask(UpdateLedsTask, this, ledUpdatePeriod);
 
 	
 	////////////////////////////////////////
@@ -885,7 +2562,7 @@ ComputerCard::ComputerCard()
 
 	////////////////////////////////////////
 	// Initialise CV outputs
-	// We set up the PWM here, and add the IRQ for sigma-delta later one Run() is called
+	// We set up the PWM here, and add the DMA for sigma-delta later once Run() is called
 
 	// First, tell the CV pins that the PWM is in charge of the value.
 	gpio_set_function(CV_OUT_1, GPIO_FUNC_PWM);
@@ -927,8 +2604,8 @@ ComputerCard::ComputerCard()
 	gpio_set_dir(NORMALISATION_PROBE, GPIO_OUT);
 	gpio_put(NORMALISATION_PROBE, false);
 	
-	// Initialise EEPROM (I2C)
-	i2c_init(i2c0, 100 * 1000);
+	// Initialise EEPROM (I2C), in fast mode
+	i2c_init(i2c0, 400 * 1000);
 	gpio_set_function(EEPROM_SDA, GPIO_FUNC_I2C);
 	gpio_set_function(EEPROM_SCL, GPIO_FUNC_I2C);
 
@@ -961,26 +2638,71 @@ ComputerCard::ComputerCard()
 }
 
 
-
-// Read a byte from EEPROM
-uint8_t ComputerCard::ReadByteFromEEPROM(unsigned int eeAddress)
+// Read consecutive bytes from EEPROM, as a single sequential read.
+// Returns false if the EEPROM doesn't respond.
+bool ComputerCard::ReadEEPROMBlock(unsigned int eeAddress, uint8_t *data, int length)
 {
 	uint8_t deviceAddress = EEPROM_PAGE_ADDRESS | ((eeAddress >> 8) & 0x0F);
-	uint8_t data = 0xFF;
 
 	uint8_t addr_low_byte = eeAddress & 0xFF;
-	i2c_write_blocking(i2c0, deviceAddress, &addr_low_byte, 1, false);
+	if (i2c_write_blocking(i2c0, deviceAddress, &addr_low_byte, 1, true) != 1)
+		return false;
+
+	return i2c_read_blocking(i2c0, deviceAddress, data, length, false) == length;
+}
 
-	i2c_read_blocking(i2c0, deviceAddress, &data, 1, false);
-	return data;
+// Load calibration coefficients from the flash cache, if it was made from EEPROM contents with this CRC
+bool ComputerCard::LoadCalCache(uint16_t eepromCRC)
+{
+#ifdef COMPUTERCARD_NO_CAL_CACHE
+	(void) eepromCRC;
+	return false;
+#else
+	const CalCache *cache = (const CalCache *)(XIP_BASE + COMPUTERCARD_CAL_CACHE_OFFSET);
+	if (cache->magic != CAL_CACHE_MAGIC || cache->eepromCRC != eepromCRC
+		|| cache->cacheCRC != CRCencode((const uint8_t *)cache->coeffs, sizeof(cache->coeffs)))
+	{
+		return false;
+	}
+	for (int channel = 0; channel < calMaxChannels; channel++)
+	{
+		calCoeffs[channel] = cache->coeffs[channel];
+	}
+	return true;
+#endif
 }
 
-// Read a 16-bit integer from EEPROM
-int ComputerCard::ReadIntFromEEPROM(unsigned int eeAddress)
+// Write calibration coefficients to the flash cache.
+// Called from the constructor, so before audio or other core 0 interrupts depend on flash.
+// Not deferred until audio starts: the erase stalls all flash reads, which cards'
+// code and tables make alongside the audio interrupt.
+void ComputerCard::SaveCalCache(uint16_t eepromCRC)
 {
-	uint8_t highByte = ReadByteFromEEPROM(eeAddress);
-	uint8_t lowByte = ReadByteFromEEPROM(eeAddress + 1);
-	return (highByte << 8) | lowByte;
+#ifdef COMPUTERCARD_NO_CAL_CACHE
+	(void) eepromCRC;
+#else
+	union
+	{
+		CalCache cache;
+		uint8_t bytes[FLASH_PAGE_SIZE];
+	} page;
+	for (unsigned i = 0; i < FLASH_PAGE_SIZE; i++)
+	{
+		page.bytes[i] = 0xFF;
+	}
+	page.cache.magic = CAL_CACHE_MAGIC;
+	page.cache.eepromCRC = eepromCRC;
+	for (int channel = 0; channel < calMaxChannels; channel++)
+	{
+		page.cache.coeffs[channel] = calCoeffs[channel];
+	}
+	page.cache.cacheCRC = CRCencode((const uint8_t *)page.cache.coeffs, sizeof(page.cache.coeffs));
+
+	uint32_t irq = save_and_disable_interrupts();
+	flash_range_erase(COMPUTERCARD_CAL_CACHE_OFFSET, FLASH_SECTOR_SIZE);
+	flash_range_program(COMPUTERCARD_CAL_CACHE_OFFSET, page.bytes, FLASH_PAGE_SIZE);
+	restore_interrupts(irq);
+#endif
 }
 
 uint16_t ComputerCard::CRCencode(const uint8_t *data, int length)
@@ -1023,20 +2745,31 @@ int ComputerCard::ReadEEPROM()
 	calibrationTable[1][2].voltage = 20; // +2V
 	calibrationTable[1][2].dacSetting = 174400;
 
-	if (ReadIntFromEEPROM(EEPROM_ADDR_ID) != EEPROM_VAL_ID)
+	uint8_t id[2];
+	if (!ReadEEPROMBlock(EEPROM_ADDR_ID, id, 2) || ((id[0] << 8) | id[1]) != EEPROM_VAL_ID)
 	{
 		return 1;
 	}
-	uint8_t buf[EEPROM_NUM_BYTES];
-	for (int i = 0; i < EEPROM_NUM_BYTES; i++)
+
+	// If the stored CRC matches the flash cache, the cached coefficients are current
+	uint8_t crc[2];
+	if (!ReadEEPROMBlock(EEPROM_ADDR_CRC_H, crc, 2))
 	{
-		buf[i] = ReadByteFromEEPROM(i);
+		return 1;
+	}
+	uint16_t foundCRC = ((uint16_t)crc[0] << 8) | crc[1]; // EEPROM_ADDR_CRC_H, then EEPROM_ADDR_CRC_L
+	if (LoadCalCache(foundCRC))
+	{
+		return 0;
 	}
 
+	uint8_t buf[EEPROM_NUM_BYTES];
+	if (!ReadEEPROMBlock(0, buf, EEPROM_NUM_BYTES))
+	{
+		return 1;
+	}
 
 	uint16_t calculatedCRC = CRCencode(buf, 86);
-	uint16_t foundCRC = ((uint16_t)buf[EEPROM_ADDR_CRC_H] << 8) | buf[EEPROM_ADDR_CRC_L];
-
 	if (calculatedCRC != foundCRC)
 	{
 		return 1;
@@ -1067,6 +2800,7 @@ int ComputerCard::ReadEEPROM()
 		CalcCalCoeffs(channel);
 	}
 
+	SaveCalCache(foundCRC);
 	return 0;
 }
 
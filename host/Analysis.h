@@ -0,0 +1,256 @@
+/*
+Audio measurements for the host tools
+
+Signals are mono, at 48kHz, scaled so that full scale (2048 in card units) is 1.0.
+*/
+
+#ifndef ANALYSIS_H
+#define ANALYSIS_H
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstdint>
+#include <vector>
+
+static constexpr double sampleRate = 48000.0;
+
+// In-place radix-2 FFT; x.size() must be a power of two
+inline void Fft(std::vector<std::complex<double>> &x)
+{
+    size_t n = x.size();
+    for (size_t i = 1, j = 0; i < n; i++)
+    {
+        size_t bit = n >> 1;
+        for (; j & bit; bit >>= 1) j ^= bit;
+        j ^= bit;
+        if (i < j) std::swap(x[i], x[j]);
+    }
+    for (size_t len = 2; len <= n; len <<= 1)
+    {
+        std::complex<double> w = std::polar(1.0, -2 * M_PI / len);
+        for (size_t i = 0; i < n; i += len)
+        {
+            std::complex<double> wk = 1;
+            for (size_t k = 0; k < len / 2; k++, wk *= w)
+            {
+                std::complex<double> a = x[i + k], b = x[i + k + len / 2] * wk;
+                x[i + k] = a + b;
+                x[i + k + len / 2] = a - b;
+            }
+        }
+    }
+}
+
+// Magnitude spectrum (bins 0 to size/2) of signal from start, Hann windowed,
+// zero-padded if the signal is short
+inline std::vector<double> MagnitudeSpectrum(const std::vector<double> &signal, size_t start, size_t size)
+{
+    std::vector<std::complex<double>> x(size);
+    for (size_t i = 0; i < size && start + i < signal.size(); i++)
+    {
+        x[i] = signal[start + i] * (0.5 - 0.5 * std::cos(2 * M_PI * i / size));
+    }
+    Fft(x);
+    std::vector<double> mag(size / 2 + 1);
+    for (size_t i = 0; i < mag.size(); i++) mag[i] = std::abs(x[i]);
+    return mag;
+}
+
+inline double Rms(const std::vector<double> &signal, size_t start = 0, size_t end = SIZE_MAX)
+{
+    end = std::min(end, signal.size());
+    double sum = 0;
+    for (size_t i = start; i < end; i++) sum += signal[i] * signal[i];
+    return end > start ? std::sqrt(sum / (end - start)) : 0;
+}
+
+inline double Peak(const std::vector<double> &signal)
+{
+    double peak = 0;
+    for (double s : signal) peak = std::max(peak, std::fabs(s));
+    return peak;
+}
+
+inline double Decibels(double x)
+{
+    return 20 * std::log10(std::max(x, 1e-10));
+}
+
+// Time in seconds, from the loudest 10ms window at or after start, until the
+// RMS in 10ms windows falls for good 60dB below it, or to 1 LSB of the card's
+// 12-bit outputs if that's higher. Negative if it's still above at the end.
+inline double DecayTime(const std::vector<double> &signal, size_t start)
+{
+    const size_t window = 480;
+    std::vector<double> envelope;
+    for (size_t i = start; i + window <= signal.size(); i += window)
+    {
+        envelope.push_back(Rms(signal, i, i + window));
+    }
+
+    size_t loudest = 0;
+    for (size_t i = 0; i < envelope.size(); i++)
+    {
+        if (envelope[i] > envelope[loudest]) loudest = i;
+    }
+    if (envelope.empty() || envelope[loudest] == 0) return -1;
+
+    double threshold = std::max(envelope[loudest] * 0.001, 1.0 / 2048);
+    size_t quiet = envelope.size();
+    while (quiet > loudest && envelope[quiet - 1] <= threshold) quiet--;
+    if (quiet == envelope.size()) return -1;
+    return (quiet - loudest) * window / sampleRate;
+}
+
+// Mean frequency of the magnitude spectrum, averaged over 4096-sample frames from start
+inline double SpectralCentroid(const std::vector<double> &signal, size_t start)
+{
+    const size_t frame = 4096;
+    std::vector<double> sum(frame / 2 + 1);
+    for (size_t i = start; i < signal.size(); i += frame)
+    {
+        std::vector<double> mag = MagnitudeSpectrum(signal, i, frame);
+        for (size_t k = 0; k < sum.size(); k++) sum[k] += mag[k];
+    }
+
+    double weighted = 0, total = 0;
+    for (size_t k = 1; k < sum.size(); k++)
+    {
+        weighted += sum[k] * k * sampleRate / frame;
+        total += sum[k];
+    }
+    return total > 0 ? weighted / total : 0;
+}
+
+// Amplitude of the sinusoid at freq, from a Hann-windowed DFT of signal[start, start+length)
+inline double ToneAmplitude(const std::vector<double> &signal, size_t start, size_t length, double freq)
+{
+    std::complex<double> sum = 0;
+    double windowSum = 0;
+    for (size_t i = 0; i < length; i++)
+    {
+        double w = 0.5 - 0.5 * std::cos(2 * M_PI * i / length);
+        sum += w * signal[start + i] * std::polar(1.0, -2 * M_PI * freq * i / sampleRate);
+        windowSum += w;
+    }
+    return 2 * std::abs(sum) / windowSum;
+}
+
+// THD+N: RMS of what's left after removing the best-fitting sinusoid at freq (and DC),
+// relative to that sinusoid's RMS
+inline double ThdPlusNoise(const std::vector<double> &signal, size_t start, size_t length, double freq)
+{
+    // Least squares fit of a*cos + b*sin + c, by the normal equations
+    double m[3][4] = {};
+    for (size_t i = 0; i < length; i++)
+    {
+        double phase = 2 * M_PI * freq * i / sampleRate;
+        double basis[3] = {std::cos(phase), std::sin(phase), 1.0};
+        for (int r = 0; r < 3; r++)
+        {
+            for (int c = 0; c < 3; c++) m[r][c] += basis[r] * basis[c];
+            m[r][3] += basis[r] * signal[start + i];
+        }
+    }
+    for (int r = 0; r < 3; r++)
+    {
+        for (int k = 0; k < 3; k++)
+        {
+            if (k == r) continue;
+            double f = m[k][r] / m[r][r];
+            for (int c = 0; c < 4; c++) m[k][c] -= f * m[r][c];
+        }
+    }
+    double a = m[0][3] / m[0][0], b = m[1][3] / m[1][1], dc = m[2][3] / m[2][2];
+
+    double residual = 0;
+    for (size_t i = 0; i < length; i++)
+    {
+        double phase = 2 * M_PI * freq * i / sampleRate;
+        double e = signal[start + i] - (a * std::cos(phase) + b * std::sin(phase) + dc);
+        residual += e * e;
+    }
+    double fundamental = std::sqrt((a * a + b * b) / 2);
+    return fundamental > 0 ? std::sqrt(residual / length) / fundamental : 0;
+}
+
+// THD: RMS of harmonics 2 to 10 below Nyquist, relative to the fundamental at freq,
+// each from ToneAmplitude. Unlike ThdPlusNoise, a slow drift in pitch, as from a
+// swept delay, spreads each tone within its bin rather than counting as noise.
+inline double Thd(const std::vector<double> &signal, size_t start, size_t length, double freq)
+{
+    double fundamental = ToneAmplitude(signal, start, length, freq);
+    double sum = 0;
+    for (int h = 2; h <= 10 && h * freq < sampleRate / 2; h++)
+    {
+        double a = ToneAmplitude(signal, start, length, h * freq);
+        sum += a * a;
+    }
+    return fundamental > 0 ? std::sqrt(sum) / fundamental : 0;
+}
+
+// Largest spectral component, relative to the fundamental at freq, that isn't
+// at DC or a harmonic below Nyquist: for a tone through a nonlinearity, these are
+// harmonics above Nyquist that have aliased. length must be a power of two.
+inline double SpurLevel(const std::vector<double> &signal, size_t start, size_t length, double freq)
+{
+    std::vector<double> mag = MagnitudeSpectrum(signal, start, length);
+    double binWidth = sampleRate / length;
+    const double guardBins = 4; // Hann main lobe, plus some
+
+    double fundamental = 0, spur = 0;
+    for (size_t k = 0; k < mag.size(); k++)
+    {
+        double f = k * binWidth;
+        if (f < guardBins * binWidth) continue;
+        double harmonic = std::round(f / freq);
+        bool nearHarmonic = harmonic >= 1 && std::fabs(f - harmonic * freq) < guardBins * binWidth;
+        if (nearHarmonic && harmonic == 1) fundamental = std::max(fundamental, mag[k]);
+        else if (!nearHarmonic) spur = std::max(spur, mag[k]);
+    }
+    return fundamental > 0 ? spur / fundamental : 0;
+}
+
+// Magnitude spectrum of signal[start, start+length), Hann windowed and zero-padded
+// to at least four times its length, for finding peak frequencies. Unlike
+// MagnitudeSpectrum, the window covers just the signal, not the padding.
+inline std::vector<double> PaddedSpectrum(const std::vector<double> &signal, size_t start, size_t length)
+{
+    size_t size = 1;
+    while (size < length * 4) size <<= 1;
+    std::vector<std::complex<double>> x(size);
+    for (size_t i = 0; i < length && start + i < signal.size(); i++)
+    {
+        x[i] = signal[start + i] * (0.5 - 0.5 * std::cos(2 * M_PI * i / length));
+    }
+    Fft(x);
+    std::vector<double> mag(size / 2 + 1);
+    for (size_t i = 0; i < mag.size(); i++) mag[i] = std::abs(x[i]);
+    return mag;
+}
+
+// Frequency of the strongest peak of a PaddedSpectrum within +/- cents of nearFreq,
+// refined by parabolic interpolation of the log magnitude. 0 if the strongest bin
+// in range is at its edge, i.e. there is no peak there.
+inline double PeakFrequency(const std::vector<double> &mag, double nearFreq, double cents)
+{
+    double binWidth = sampleRate / ((mag.size() - 1) * 2);
+    double ratio = std::pow(2.0, cents / 1200);
+    size_t lo = (size_t) (nearFreq / ratio / binWidth), hi = (size_t) (nearFreq * ratio / binWidth) + 1;
+    hi = std::min(hi, mag.size() - 2);
+    if (lo < 1 || lo >= hi) return 0;
+
+    size_t best = lo;
+    for (size_t k = lo; k <= hi; k++)
+    {
+        if (mag[k] > mag[best]) best = k;
+    }
+    if (best == lo || best == hi) return 0;
+
+    double a = std::log(mag[best - 1] + 1e-30), b = std::log(mag[best] + 1e-30), c = std::log(mag[best + 1] + 1e-30);
+    double offset = 0.5 * (a - c) / (a - 2 * b + c);
+    return (best + offset) * binWidth;
+}
+
+#endif
@@ -0,0 +1,127 @@
+/*
+Offline rendering of a card with fixed controls and a test input, for the host tools
+*/
+
+#ifndef RENDER_H
+#define RENDER_H
+
+#include "ComputerCard.h"
+
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+struct RenderSettings
+{
+    enum Stimulus {Silence, Impulse, Noise, Sine};
+
+    int32_t knobs[3] = {2048, 2048, 2048};
+    int16_t cv[2] = {0, 0};
+    bool cvConnected[2] = {false, false};
+    int modePresses = 0; // switch Down presses, made while the controls settle
+    ComputerCard::Switch switchVal = ComputerCard::Middle;
+
+    Stimulus stimulus = Impulse;
+    double frequency = 1000; // Sine
+    double level = 0.5; // of full scale
+    double noiseSeconds = 0.1; // Noise burst length
+    bool pluck = false; // pulse on Pulse In 1 when the stimulus starts
+    double seconds = 2; // after the stimulus starts
+};
+
+struct RenderResult
+{
+    std::vector<double> out[2]; // audio outputs, full scale 1.0
+    size_t start; // sample at which the stimulus starts
+
+    std::vector<double> Mono() const
+    {
+        std::vector<double> mono(out[0].size());
+        for (size_t i = 0; i < mono.size(); i++) mono[i] = 0.5 * (out[0][i] + out[1][i]);
+        return mono;
+    }
+};
+
+// Samples for the card's smoothing filters to settle, and mode presses to be made
+static constexpr size_t renderSettleSamples = 4800;
+static constexpr int renderPressSamples = 200; // 100 down, 100 middle
+static constexpr int renderMaxModePresses = (renderSettleSamples - 100) / renderPressSamples;
+
+// Render a newly constructed Card, with its inputs all connected except CV inputs not set
+template <class Card>
+RenderResult Render(const RenderSettings &s)
+{
+    std::unique_ptr<Card> card(new Card);
+    ComputerCard::ConfigureInterpolators();
+
+    RenderResult result;
+    result.start = renderSettleSamples;
+    size_t length = result.start + (size_t) (s.seconds * 48000);
+    result.out[0].resize(length);
+    result.out[1].resize(length);
+
+    ComputerCard::TraceInputs in;
+    memset(&in, 0, sizeof(in));
+    for (int i = 0; i < 3; i++) in.knobs[i] = s.knobs[i];
+    for (int i = 0; i < 2; i++) in.cv[i] = s.cv[i];
+    for (int i = 0; i < 6; i++) in.connected[i] = true;
+    in.connected[ComputerCard::CV1] = s.cvConnected[0];
+    in.connected[ComputerCard::CV2] = s.cvConnected[1];
+    in.connected[ComputerCard::Pulse1] = s.pluck;
+    in.quality = ComputerCard::Full;
+
+    uint32_t lcg = 1;
+    for (size_t n = 0; n < length; n++)
+    {
+        in.sampleTime = ComputerCard::TraceSampleTime(n);
+
+        // Mode presses from sample 100, then the requested switch position
+        int press = ((int) n - 100) / renderPressSamples;
+        bool down = n >= 100 && press < s.modePresses && ((n - 100) % renderPressSamples) < renderPressSamples / 2;
+        in.switchVal = down ? ComputerCard::Down : (n < result.start ? ComputerCard::Middle : s.switchVal);
+
+        double x = 0;
+        size_t t = n - result.start;
+        if (n >= result.start)
+        {
+            switch (s.stimulus)
+            {
+            case RenderSettings::Silence:
+                break;
+            case RenderSettings::Impulse:
+                x = (t == 0);
+                break;
+            case RenderSettings::Noise:
+                lcg = 1664525 * lcg + 1013904223;
+                x = t < s.noiseSeconds * 48000 ? (int32_t) lcg / 2147483648.0 : 0;
+                break;
+            case RenderSettings::Sine:
+                x = std::sin(2 * M_PI * s.frequency * t / 48000);
+                break;
+            }
+        }
+        int32_t audio = (int32_t) std::lround(x * s.level * 2047);
+        in.audio[0] = in.audio[1] = audio;
+
+        in.pulse[0] = s.pluck && n >= result.start && t < 480;
+        in.numEdges[0] = 0;
+        if (s.pluck && t == 0)
+        {
+            in.edges[0][0] = {in.sampleTime, true};
+            in.numEdges[0] = 1;
+        }
+
+        int16_t audioOut[2];
+        int32_t cvOut[2];
+        card->ReplaySample(in, audioOut, cvOut);
+        for (int i = 0; i < 2; i++)
+        {
+            int32_t a = audioOut[i] < -2048 ? -2048 : (audioOut[i] > 2047 ? 2047 : audioOut[i]);
+            result.out[i][n] = a / 2048.0;
+        }
+    }
+    return result;
+}
+
+#endif
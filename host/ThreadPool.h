@@ -0,0 +1,78 @@
+/*
+Work-stealing parallel loop for the host tools
+*/
+
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/** Call job(i) for i in [0, numJobs), on numThreads threads, and wait for all to finish
+
+    Jobs are dealt out to per-thread queues in contiguous blocks. Each thread works
+    from the back of its own queue, and when that's empty steals from the front of
+    another's, so that threads given slow jobs (long decays, expensive modes) don't
+    hold up the rest.
+*/
+template <typename Job>
+void ParallelFor(size_t numJobs, unsigned numThreads, Job job)
+{
+    if (numThreads < 1) numThreads = 1;
+
+    struct Queue
+    {
+        std::mutex lock;
+        std::deque<size_t> jobs;
+    };
+    std::vector<std::unique_ptr<Queue>> queues;
+    for (unsigned t = 0; t < numThreads; t++)
+    {
+        queues.emplace_back(new Queue);
+        for (size_t i = numJobs * t / numThreads; i < numJobs * (t + 1) / numThreads; i++)
+        {
+            queues[t]->jobs.push_back(i);
+        }
+    }
+
+    auto worker = [&](unsigned self) {
+        while (true)
+        {
+            size_t i = 0;
+            bool found = false;
+            {
+                std::lock_guard<std::mutex> guard(queues[self]->lock);
+                if (!queues[self]->jobs.empty())
+                {
+                    i = queues[self]->jobs.back();
+                    queues[self]->jobs.pop_back();
+                    found = true;
+                }
+            }
+            for (unsigned v = 1; v < numThreads && !found; v++)
+            {
+                Queue &victim = *queues[(self + v) % numThreads];
+                std::lock_guard<std::mutex> guard(victim.lock);
+                if (!victim.jobs.empty())
+                {
+                    i = victim.jobs.front();
+                    victim.jobs.pop_front();
+                    found = true;
+                }
+            }
+            // Jobs are never added, so once every queue is empty we are done
+            if (!found) return;
+            job(i);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (unsigned t = 1; t < numThreads; t++) threads.emplace_back(worker, t);
+    worker(0);
+    for (std::thread &t : threads) t.join();
+}
+
+#endif
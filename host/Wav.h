@@ -0,0 +1,75 @@
+/*
+16-bit PCM WAV files, at 48kHz, for the host tools
+*/
+
+#ifndef WAV_H
+#define WAV_H
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+// Read interleaved samples; returns false unless the file is 16-bit PCM
+inline bool ReadWav(const char *path, std::vector<int16_t> &samples, int &channels)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f) return false;
+
+    char id[4];
+    uint32_t size;
+    bool ok = fread(id, 1, 4, f) == 4 && !memcmp(id, "RIFF", 4)
+        && fread(&size, 4, 1, f) == 1 && fread(id, 1, 4, f) == 4 && !memcmp(id, "WAVE", 4);
+    channels = 0;
+    while (ok && fread(id, 1, 4, f) == 4 && fread(&size, 4, 1, f) == 1)
+    {
+        if (!memcmp(id, "fmt ", 4))
+        {
+            uint8_t fmt[16];
+            ok = size >= 16 && fread(fmt, 1, 16, f) == 16;
+            channels = fmt[2] | (fmt[3] << 8);
+            ok = ok && (fmt[0] | (fmt[1] << 8)) == 1 && (fmt[14] | (fmt[15] << 8)) == 16;
+            fseek(f, size - 16 + (size & 1), SEEK_CUR);
+        }
+        else if (!memcmp(id, "data", 4))
+        {
+            samples.resize(size / 2);
+            ok = channels > 0 && fread(samples.data(), 2, samples.size(), f) == samples.size();
+            break;
+        }
+        else
+        {
+            fseek(f, size + (size & 1), SEEK_CUR);
+        }
+    }
+    fclose(f);
+    return ok && channels > 0;
+}
+
+// Write interleaved samples at 48kHz
+inline bool WriteWav(const char *path, const std::vector<int16_t> &samples, int channels)
+{
+    FILE *f = fopen(path, "wb");
+    if (!f) return false;
+
+    uint32_t dataSize = samples.size() * 2;
+    uint32_t riffSize = 36 + dataSize;
+    uint32_t fmtSize = 16, rate = 48000, byteRate = rate * channels * 2;
+    uint16_t format = 1, numChannels = channels, blockAlign = channels * 2, bits = 16;
+    fwrite("RIFF", 1, 4, f);
+    fwrite(&riffSize, 4, 1, f);
+    fwrite("WAVEfmt ", 1, 8, f);
+    fwrite(&fmtSize, 4, 1, f);
+    fwrite(&format, 2, 1, f);
+    fwrite(&numChannels, 2, 1, f);
+    fwrite(&rate, 4, 1, f);
+    fwrite(&byteRate, 4, 1, f);
+    fwrite(&blockAlign, 2, 1, f);
+    fwrite(&bits, 2, 1, f);
+    fwrite("data", 1, 4, f);
+    fwrite(&dataSize, 4, 1, f);
+    bool ok = fwrite(samples.data(), 2, samples.size(), f) == samples.size();
+    return fclose(f) == 0 && ok;
+}
+
+#endif
@@ -0,0 +1,133 @@
+/*
+Time each card's ProcessSample called through the vtable, as ComputerCard's audio
+interrupt calls it, and statically, as ComputerCardT's does
+
+usage: dispatch [--rounds N]
+
+  --rounds N  rounds of each kind of call, of which the fastest is kept (default 201)
+
+Each card is first run for 1000 samples through ReplaySample, with the knobs at
+mid-travel, the switch in the middle and a sawtooth into Audio In 1, and then keeps
+those inputs. A round calls ProcessSample 65536 times; virtual and static rounds
+alternate, so that both see the same machine. Also timed is a small card with the
+DSP of bench/'s dispatch benchmark, which the cards' own work doesn't swamp.
+
+The tool is built with speculative devirtualisation off, so that the virtual calls
+stay indirect, as they are from the interrupt. Results are in ns per sample, for
+comparing the two kinds of call on this machine; the cost on the Computer comes from
+bench/.
+*/
+
+#include "../delay/AudioDelay.h"
+#include "../resonator/ResonatingStrings.h"
+#include "../reverb/FdnReverb.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+
+static const int callsPerRound = 65536;
+
+// A card with its ProcessSample called both ways. The virtual call goes through a
+// pointer the compiler can't see through, so it can't know which card it reaches.
+template <class Card>
+class DispatchTimer : public Card
+{
+public:
+    DispatchTimer() : self(this) {}
+
+    void ProcessVirtual() {self->ProcessSample();}
+    void ProcessStatic() {this->Card::ProcessSample();}
+
+private:
+    DispatchTimer *volatile self;
+};
+
+// The DSP of bench/'s dispatch benchmark: a delay line with filtered feedback
+class DispatchBenchCard : public ComputerCardT<DispatchBenchCard>
+{
+    friend ComputerCardT;
+
+protected:
+    void ProcessSample() override
+    {
+        int32_t in = AudioIn1();
+        int32_t delayed = line.Read(1000, 100);
+        lowpass += ((delayed - lowpass) * 30000 + 32768) >> 16;
+        line.Write((int16_t)(in + ((lowpass * 3) >> 2)));
+        line.Advance();
+        AudioOut1((int16_t)delayed);
+    }
+
+private:
+    int32_t lowpass = 0;
+    InterpDelayLine<1024> line;
+};
+
+template <class F>
+static double NanosecondsPerCall(F call)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < callsPerRound; i++) call();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() / callsPerRound;
+}
+
+template <class Card>
+static void TimeCard(const char *name, int rounds)
+{
+    std::unique_ptr<DispatchTimer<Card>> card(new DispatchTimer<Card>);
+    DispatchTimer<Card> *timer = card.get();
+
+    ComputerCard::TraceInputs in;
+    memset(&in, 0, sizeof(in));
+    for (int k = 0; k < 3; k++) in.knobs[k] = 2048;
+    for (int i = 0; i < 6; i++) in.connected[i] = true;
+    in.switchVal = ComputerCard::Middle;
+    in.quality = ComputerCard::Full;
+    for (int n = 0; n < 1000; n++)
+    {
+        in.sampleTime = ComputerCard::TraceSampleTime(n);
+        in.audio[0] = (int16_t)((n * 37) % 2000 - 1000);
+        int16_t audioOut[2];
+        int32_t cvOut[2];
+        card->ReplaySample(in, audioOut, cvOut);
+    }
+
+    double bestVirtual = 1e9, bestStatic = 1e9;
+    for (int r = 0; r < rounds; r++)
+    {
+        double v = NanosecondsPerCall([timer] { timer->ProcessVirtual(); });
+        double s = NanosecondsPerCall([timer] { timer->ProcessStatic(); });
+        if (v < bestVirtual) bestVirtual = v;
+        if (s < bestStatic) bestStatic = s;
+    }
+    printf("| %s | %.1f | %.1f |\n", name, bestVirtual, bestStatic);
+}
+
+int main(int argc, char **argv)
+{
+    int rounds = 201;
+    bool ok = true;
+    for (int i = 1; i < argc && ok; i++)
+    {
+        if (!strcmp(argv[i], "--rounds") && i + 1 < argc) rounds = atoi(argv[++i]);
+        else ok = false;
+    }
+    if (!ok || rounds < 1)
+    {
+        fprintf(stderr, "usage: %s [--rounds N]\n", argv[0]);
+        return 2;
+    }
+
+    ComputerCard::ConfigureInterpolators();
+    printf("| Card | Virtual (ns/sample) | Static (ns/sample) |\n");
+    printf("|------|--------------------:|-------------------:|\n");
+    TimeCard<AudioDelay>("`AudioDelay`", rounds);
+    TimeCard<ResonatingStrings>("`ResonatingStrings`", rounds);
+    TimeCard<FdnReverb>("`FdnReverb`", rounds);
+    TimeCard<DispatchBenchCard>("Dispatch bench card", rounds);
+    return 0;
+}
@@ -0,0 +1,251 @@
+/*
+Host stand-ins for the parts of the Pico SDK used by ComputerCard.h
+
+Enough of the SDK for ComputerCard and the cards to compile and run on a
+desktop machine, so that ReplaySample can play back a control trace.
+Hardware setup calls do nothing; the EEPROM and flash read as absent.
+The hardware emulated is INTERP0, in the blend configuration that
+ComputerCard::ConfigureInterpolators sets up for InterpDelayLine, and the
+GPIO output latches. Fixed-point values out of their format's range abort,
+through host_fixed_overflow.
+*/
+
+#ifndef PICO_HOST_H
+#define PICO_HOST_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+
+typedef unsigned int uint;
+typedef volatile uint32_t io_rw_32;
+typedef const volatile uint32_t io_ro_32;
+typedef volatile uint32_t io_wo_32;
+
+#define __not_in_flash_func(x) x
+#define __time_critical_func(x) x
+
+#define XIP_BASE 0x10000000
+#define PICO_FLASH_SIZE_BYTES (2 * 1024 * 1024)
+#define FLASH_PAGE_SIZE 256u
+#define FLASH_SECTOR_SIZE 4096u
+
+#define PICO_ERROR_GENERIC (-1)
+#define PICO_HIGHEST_IRQ_PRIORITY 0x00
+#define PICO_DEFAULT_IRQ_PRIORITY 0x80
+
+typedef void (*irq_handler_t)(void);
+
+enum irq_num_rp2040 {TIMER_IRQ_0 = 0, PWM_IRQ_WRAP = 4, DMA_IRQ_0 = 11, DMA_IRQ_1 = 12, IO_IRQ_BANK0 = 13};
+enum dreq_num_rp2040 {DREQ_SPI0_TX = 16, DREQ_PWM_WRAP0 = 24, DREQ_ADC = 36};
+enum dma_channel_transfer_size {DMA_SIZE_8 = 0, DMA_SIZE_16 = 1, DMA_SIZE_32 = 2};
+enum gpio_function {GPIO_FUNC_SPI = 1, GPIO_FUNC_I2C = 3, GPIO_FUNC_PWM = 4, GPIO_FUNC_SIO = 5};
+enum gpio_irq_level {GPIO_IRQ_EDGE_FALL = 0x4, GPIO_IRQ_EDGE_RISE = 0x8};
+enum spi_cpol_t {SPI_CPOL_0 = 0};
+enum spi_cpha_t {SPI_CPHA_0 = 0};
+enum spi_order_t {SPI_MSB_FIRST = 1};
+enum clock_index {clk_ref = 4, clk_sys = 5};
+
+#define GPIO_OUT 1
+#define GPIO_IN 0
+
+
+////////////////////////////////////////
+// Register blocks, as plain memory
+
+typedef struct
+{
+	io_rw_32 read_addr, write_addr, transfer_count, ctrl_trig;
+	io_rw_32 al1_ctrl, al1_read_addr, al1_write_addr, al1_transfer_count_trig;
+} dma_channel_hw_t;
+
+typedef struct
+{
+	dma_channel_hw_t ch[12];
+	io_rw_32 ints0, ints1;
+} dma_hw_t;
+
+typedef struct {io_rw_32 csr, div, ctr, cc, top;} pwm_slice_hw_t;
+typedef struct {pwm_slice_hw_t slice[8];} pwm_hw_t;
+typedef struct {io_rw_32 cs, result, fcs, fifo, div;} adc_hw_t;
+typedef struct {io_rw_32 cr0, cr1, dr, sr;} spi_hw_t;
+typedef struct {io_rw_32 csr, rvr, cvr, calib;} systick_hw_t;
+typedef struct {io_rw_32 timerawh, timerawl;} timer_hw_t;
+
+typedef struct spi_inst spi_inst_t;
+typedef struct i2c_inst i2c_inst_t;
+
+inline dma_hw_t host_dma_hw;
+inline pwm_hw_t host_pwm_hw;
+inline adc_hw_t host_adc_hw;
+inline spi_hw_t host_spi_hw;
+inline systick_hw_t host_systick_hw;
+inline timer_hw_t host_timer_hw;
+
+#define dma_hw (&host_dma_hw)
+#define pwm_hw (&host_pwm_hw)
+#define adc_hw (&host_adc_hw)
+#define systick_hw (&host_systick_hw)
+#define timer_hw (&host_timer_hw)
+#define spi0 ((spi_inst_t *) nullptr)
+#define i2c0 ((i2c_inst_t *) nullptr)
+
+// Linker script symbols, for ComputerCard::PaintStack (not used on the host)
+inline uint32_t __StackBottom, __StackTop;
+
+
+////////////////////////////////////////
+// Interpolator
+
+struct interp_hw_t;
+
+// Reading PEEK1 returns the signed blend BASE0 + alpha*(BASE1-BASE0)/256,
+// rounded down, where alpha is the low 8 bits of ACCUM1
+struct host_interp_peek
+{
+	const interp_hw_t *hw;
+	int lane;
+	operator uint32_t() const;
+};
+
+struct interp_hw_t
+{
+	io_rw_32 accum[2];
+	io_rw_32 base[3];
+	host_interp_peek peek[3];
+	io_rw_32 ctrl[2];
+
+	interp_hw_t() : accum{}, base{}, peek{{this, 0}, {this, 1}, {this, 2}}, ctrl{} {}
+};
+
+inline host_interp_peek::operator uint32_t() const
+{
+	if (lane != 1) return 0;
+	int32_t base0 = (int32_t) hw->base[0];
+	int32_t base1 = (int32_t) hw->base[1];
+	int32_t alpha = hw->accum[1] & 0xFF;
+	return (uint32_t) (base0 + ((alpha * (base1 - base0)) >> 8));
+}
+
+typedef struct {uint32_t accum[2], base[3], ctrl[2];} interp_hw_save_t;
+typedef struct {uint32_t ctrl;} interp_config;
+
+// One per core on the RP2040, so one per thread here
+inline thread_local interp_hw_t host_interp0;
+#define interp0_hw (&host_interp0)
+#define interp0 interp0_hw
+
+inline interp_config interp_default_config() {return {0};}
+inline void interp_config_set_blend(interp_config *, bool) {}
+inline void interp_config_set_signed(interp_config *, bool) {}
+inline void interp_config_set_mask(interp_config *, uint, uint) {}
+inline void interp_set_config(interp_hw_t *, uint, interp_config *) {}
+
+inline void interp_save(interp_hw_t *interp, interp_hw_save_t *save)
+{
+	for (int i = 0; i < 2; i++) save->accum[i] = interp->accum[i];
+	for (int i = 0; i < 3; i++) save->base[i] = interp->base[i];
+}
+
+inline void interp_restore(interp_hw_t *interp, interp_hw_save_t *save)
+{
+	for (int i = 0; i < 2; i++) interp->accum[i] = save->accum[i];
+	for (int i = 0; i < 3; i++) interp->base[i] = save->base[i];
+}
+
+
+////////////////////////////////////////
+// GPIO: outputs latch, so that gpio_get reads back what gpio_put set.
+// ReplaySample keeps a card's pulse outputs in the card, so doesn't use these.
+
+inline thread_local uint32_t host_gpio_out = 0;
+
+inline void gpio_put(uint gpio, bool value)
+{
+	host_gpio_out = (host_gpio_out & ~(1u << gpio)) | ((uint32_t) value << gpio);
+}
+inline bool gpio_get(uint gpio) {return (host_gpio_out >> gpio) & 1;}
+inline void gpio_xor_mask(uint32_t mask) {host_gpio_out ^= mask;}
+
+
+////////////////////////////////////////
+// Everything else does nothing
+
+inline void gpio_init(uint) {}
+inline void gpio_set_dir(uint, bool) {}
+inline void gpio_set_function(uint, uint) {}
+inline void gpio_set_pulls(uint, bool, bool) {}
+inline void gpio_pull_up(uint) {}
+inline void gpio_disable_pulls(uint) {}
+inline void gpio_set_irq_enabled(uint, uint32_t, bool) {}
+inline void gpio_add_raw_irq_handler_masked(uint32_t, irq_handler_t) {}
+inline void gpio_remove_raw_irq_handler_masked(uint32_t, irq_handler_t) {}
+inline void gpio_acknowledge_irq(uint, uint32_t) {}
+inline uint32_t gpio_get_irq_event_mask(uint) {return 0;}
+
+inline void irq_set_enabled(uint, bool) {}
+inline void irq_set_exclusive_handler(uint, irq_handler_t) {}
+inline void irq_remove_handler(uint, irq_handler_t) {}
+inline void irq_set_priority(uint, uint8_t) {}
+
+typedef struct {uint32_t csr, div, top;} pwm_config;
+inline pwm_config pwm_get_default_config() {return {0, 0, 0};}
+inline void pwm_config_set_wrap(pwm_config *, uint16_t) {}
+inline void pwm_init(uint, pwm_config *, bool) {}
+inline uint pwm_gpio_to_slice_num(uint gpio) {return (gpio >> 1) & 7;}
+inline void pwm_set_gpio_level(uint, uint16_t) {}
+
+inline void adc_init() {}
+inline void adc_gpio_init(uint) {}
+inline void adc_select_input(uint) {}
+inline void adc_set_round_robin(uint) {}
+inline void adc_fifo_setup(bool, bool, uint, bool, bool) {}
+inline void adc_set_clkdiv(float) {}
+inline void adc_run(bool) {}
+
+typedef struct {uint32_t ctrl;} dma_channel_config;
+inline int dma_claim_unused_channel(bool) {return 0;}
+inline dma_channel_config dma_channel_get_default_config(uint) {return {0};}
+inline void channel_config_set_transfer_data_size(dma_channel_config *, enum dma_channel_transfer_size) {}
+inline void channel_config_set_read_increment(dma_channel_config *, bool) {}
+inline void channel_config_set_write_increment(dma_channel_config *, bool) {}
+inline void channel_config_set_dreq(dma_channel_config *, uint) {}
+inline void channel_config_set_ring(dma_channel_config *, bool, uint) {}
+inline void channel_config_set_chain_to(dma_channel_config *, uint) {}
+inline void dma_channel_configure(uint, const dma_channel_config *, volatile void *, const volatile void *, uint, bool) {}
+inline void dma_channel_set_irq0_enabled(uint, bool) {}
+inline void dma_channel_set_irq1_enabled(uint, bool) {}
+inline void dma_channel_set_write_addr(uint, volatile void *, bool) {}
+inline void dma_channel_set_read_addr(uint, const volatile void *, bool) {}
+inline void dma_channel_cleanup(uint) {}
+
+inline uint spi_init(spi_inst_t *, uint baudrate) {return baudrate;}
+inline void spi_set_format(spi_inst_t *, uint, spi_cpol_t, spi_cpha_t, spi_order_t) {}
+inline spi_hw_t *spi_get_hw(spi_inst_t *) {return &host_spi_hw;}
+
+inline uint i2c_init(i2c_inst_t *, uint baudrate) {return baudrate;}
+inline int i2c_write_blocking(i2c_inst_t *, uint8_t, const uint8_t *, size_t, bool) {return PICO_ERROR_GENERIC;}
+inline int i2c_read_blocking(i2c_inst_t *, uint8_t, uint8_t *, size_t, bool) {return PICO_ERROR_GENERIC;}
+
+inline void flash_get_unique_id(uint8_t *id) {for (int i = 0; i < 8; i++) id[i] = 0;}
+inline void flash_range_erase(uint32_t, size_t) {}
+inline void flash_range_program(uint32_t, const uint8_t *, size_t) {}
+
+inline uint32_t clock_get_hz(enum clock_index) {return 125000000;}
+inline uint32_t time_us_32() {return 0;}
+inline void sleep_us(uint64_t) {}
+
+inline uint32_t save_and_disable_interrupts() {return 0;}
+inline void restore_interrupts(uint32_t) {}
+inline void __wfi() {}
+inline void __dmb() {}
+
+// Called by ComputerCard's Fixed for a value outside its format
+inline void host_fixed_overflow(int64_t raw, int intBits, int fracBits)
+{
+    fprintf(stderr, "Fixed<%d, %d> overflow: raw value %lld\n", intBits, fracBits, (long long)raw);
+    abort();
+}
+
+#endif
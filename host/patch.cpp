@@ -0,0 +1,408 @@
+/*
+Render a patch of several cards, cabled together, offline
+
+usage: patch patch.txt out.wav [--seconds S] [--profile]
+
+  --seconds S  render length (default: the longest input WAV, or 10s)
+  --profile    time each card's ProcessSample, and report the cost per sample
+
+The patch file has one statement per line; # starts a comment.
+
+  card <name> delay|resonator|harmonizer|reverb
+  wav <name> <file.wav>             16-bit 48kHz input; its channels are <name>.1, <name>.2, ...
+  connect <source> <card>.<jack>    jacks: audio1 audio2 cv1 cv2 pulse1 pulse2
+  output <source> [<source> ...]    the channels of out.wav
+  [at <seconds>] set <card> main|x|y <0-4095>
+  [at <seconds>] set <card> switch down|middle|up
+  [at <seconds>] press <card> [count]   switch down and back, 100 samples each way
+
+A source is a card's output jack, <card>.<jack>, or a WAV channel. Inputs with
+nothing connected read as unplugged; knobs start at 2048, switches in the middle.
+
+Every cable delays by one sample: each card processes sample n with its inputs
+from the outputs of sample n-1. So the order of the cards doesn't matter, and
+feedback patches work. Levels are in card units (-2048 to 2047, about 6V) from jack
+to jack: an audio or CV output of 1000 reads as 1000 at the input it's patched
+to. A high pulse output reads as 1706 (5V); a pulse input is high above 341 (1V),
+and each change is an edge, timed at the start of the sample that sees it.
+WAV samples are scaled by 1/16 going in, and outputs by 16 coming out.
+*/
+
+#include "../delay/AudioDelay.h"
+#include "../resonator/ResonatingStrings.h"
+#include "../harmonizer/SimplePitchShifter.h"
+#include "../reverb/FdnReverb.h"
+#include "Wav.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+template <class Card>
+static std::shared_ptr<ComputerCard> MakeCard()
+{
+    return std::shared_ptr<ComputerCard>(new Card);
+}
+
+struct CardType
+{
+    const char *name;
+    std::shared_ptr<ComputerCard> (*make)();
+};
+static const CardType cardTypes[] = {
+    {"delay", MakeCard<AudioDelay>},
+    {"resonator", MakeCard<ResonatingStrings>},
+    {"harmonizer", MakeCard<SimplePitchShifter>},
+    {"reverb", MakeCard<FdnReverb>},
+};
+
+// Jacks, in ComputerCard::Input order; outputs and inputs alike
+static const char *jackNames[6] = {"audio1", "audio2", "cv1", "cv2", "pulse1", "pulse2"};
+static const int32_t pulseHigh = 1706, pulseThreshold = 341;
+
+struct Source
+{
+    int card = -1, wav = -1; // one of these is set
+    int index = 0; // jack, or WAV channel
+};
+
+struct Card
+{
+    std::string name, type;
+    std::shared_ptr<ComputerCard> card;
+    bool connected[6] = {};
+    Source inputs[6];
+    int32_t out[6] = {}; // output jacks after the last sample
+    bool lastPulseIn[2] = {};
+    ComputerCard::TraceInputs in;
+    double totalMicros = 0, maxMicros = 0;
+};
+
+struct Wav
+{
+    std::string name;
+    std::vector<int16_t> samples;
+    int channels;
+    size_t Length() const {return samples.size() / channels;}
+};
+
+// Control change, applied at the start of a sample
+struct Event
+{
+    size_t sample;
+    int card;
+    int control; // ComputerCard::Knob, or switchControl
+    int value;
+};
+static const int switchControl = 3;
+
+struct Patch
+{
+    std::vector<Card> cards;
+    std::vector<Wav> wavs;
+    std::vector<Source> outputs;
+    std::vector<Event> events;
+};
+
+static int FindCard(const Patch &p, const std::string &name)
+{
+    for (size_t i = 0; i < p.cards.size(); i++)
+    {
+        if (p.cards[i].name == name) return i;
+    }
+    return -1;
+}
+
+static int FindJack(const std::string &name)
+{
+    for (int j = 0; j < 6; j++)
+    {
+        if (name == jackNames[j]) return j;
+    }
+    return -1;
+}
+
+// <card>.<jack> or <wav>.<channel>
+static bool ParseSource(const Patch &p, const std::string &s, Source &source)
+{
+    size_t dot = s.find('.');
+    if (dot == std::string::npos) return false;
+    std::string name = s.substr(0, dot), jack = s.substr(dot + 1);
+    source.card = FindCard(p, name);
+    if (source.card >= 0)
+    {
+        source.index = FindJack(jack);
+        return source.index >= 0;
+    }
+    for (size_t i = 0; i < p.wavs.size(); i++)
+    {
+        if (p.wavs[i].name == name)
+        {
+            source.wav = i;
+            source.index = atoi(jack.c_str()) - 1;
+            return source.index >= 0 && source.index < p.wavs[i].channels;
+        }
+    }
+    return false;
+}
+
+static bool ReadPatch(const char *path, Patch &p)
+{
+    std::ifstream file(path);
+    if (!file)
+    {
+        fprintf(stderr, "%s: can't read\n", path);
+        return false;
+    }
+
+    std::string line;
+    for (int lineNum = 1; std::getline(file, line); lineNum++)
+    {
+        line = line.substr(0, line.find('#'));
+        std::istringstream words(line);
+        std::vector<std::string> w;
+        for (std::string word; words >> word;) w.push_back(word);
+        if (w.empty()) continue;
+
+        auto error = [&](const char *what) {
+            fprintf(stderr, "%s:%d: %s\n", path, lineNum, what);
+            return false;
+        };
+
+        size_t sample = 0;
+        if (w[0] == "at")
+        {
+            if (w.size() < 3) return error("expected: at <seconds> <statement>");
+            sample = (size_t) std::max(0.0, atof(w[1].c_str()) * 48000 + 0.5);
+            w.erase(w.begin(), w.begin() + 2);
+            if (w[0] != "set" && w[0] != "press") return error("only set and press can be timed");
+        }
+
+        if (w[0] == "card" && w.size() == 3)
+        {
+            if (FindCard(p, w[1]) >= 0) return error("card name already used");
+            Card c;
+            c.name = w[1];
+            c.type = w[2];
+            for (const CardType &t : cardTypes)
+            {
+                if (w[2] == t.name) c.card = t.make();
+            }
+            if (!c.card) return error("unknown card type");
+            p.cards.push_back(c);
+        }
+        else if (w[0] == "wav" && w.size() == 3)
+        {
+            Wav wav;
+            wav.name = w[1];
+            if (!ReadWav(w[2].c_str(), wav.samples, wav.channels)) return error("can't read 16-bit PCM WAV");
+            p.wavs.push_back(wav);
+        }
+        else if (w[0] == "connect" && w.size() == 3)
+        {
+            Source from, to;
+            if (!ParseSource(p, w[1], from)) return error("unknown source");
+            if (!ParseSource(p, w[2], to) || to.card < 0) return error("unknown card input");
+            Card &c = p.cards[to.card];
+            if (c.connected[to.index]) return error("input already connected");
+            c.connected[to.index] = true;
+            c.inputs[to.index] = from;
+        }
+        else if (w[0] == "output" && w.size() >= 2)
+        {
+            for (size_t i = 1; i < w.size(); i++)
+            {
+                Source s;
+                if (!ParseSource(p, w[i], s)) return error("unknown source");
+                p.outputs.push_back(s);
+            }
+        }
+        else if (w[0] == "set" && w.size() == 4)
+        {
+            Event e = {sample, FindCard(p, w[1]), -1, atoi(w[3].c_str())};
+            if (e.card < 0) return error("unknown card");
+            if (w[2] == "main") e.control = ComputerCard::Main;
+            else if (w[2] == "x") e.control = ComputerCard::X;
+            else if (w[2] == "y") e.control = ComputerCard::Y;
+            else if (w[2] == "switch")
+            {
+                e.control = switchControl;
+                if (w[3] == "down") e.value = ComputerCard::Down;
+                else if (w[3] == "middle") e.value = ComputerCard::Middle;
+                else if (w[3] == "up") e.value = ComputerCard::Up;
+                else return error("switch position: down, middle or up");
+            }
+            else return error("controls: main, x, y, switch");
+            p.events.push_back(e);
+        }
+        else if (w[0] == "press" && (w.size() == 2 || w.size() == 3))
+        {
+            int card = FindCard(p, w[1]);
+            int count = w.size() == 3 ? atoi(w[2].c_str()) : 1;
+            if (card < 0) return error("unknown card");
+            for (int i = 0; i < count; i++)
+            {
+                p.events.push_back({sample + i * 200, card, switchControl, ComputerCard::Down});
+                p.events.push_back({sample + i * 200 + 100, card, switchControl, ComputerCard::Middle});
+            }
+        }
+        else return error("unknown or malformed statement");
+    }
+
+    if (p.cards.empty() || p.outputs.empty())
+    {
+        fprintf(stderr, "%s: needs at least one card and an output\n", path);
+        return false;
+    }
+    std::stable_sort(p.events.begin(), p.events.end(), [](const Event &a, const Event &b) {return a.sample < b.sample;});
+    return true;
+}
+
+// Level at a source during sample n, from the cards' outputs of sample n-1
+static int32_t SourceLevel(const Patch &p, const Source &s, size_t n)
+{
+    if (s.card >= 0) return p.cards[s.card].out[s.index];
+    const Wav &wav = p.wavs[s.wav];
+    return n < wav.Length() ? wav.samples[n * wav.channels + s.index] >> 4 : 0;
+}
+
+int main(int argc, char **argv)
+{
+    const char *patchPath = nullptr, *outPath = nullptr;
+    double seconds = 0;
+    bool profile = false;
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "--seconds") && i + 1 < argc) seconds = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--profile")) profile = true;
+        else if (!patchPath) patchPath = argv[i];
+        else if (!outPath) outPath = argv[i];
+        else patchPath = nullptr, i = argc;
+    }
+    if (!patchPath || !outPath)
+    {
+        fprintf(stderr, "usage: %s patch.txt out.wav [--seconds S] [--profile]\n", argv[0]);
+        return 2;
+    }
+
+    Patch p;
+    if (!ReadPatch(patchPath, p)) return 1;
+    ComputerCard::ConfigureInterpolators();
+
+    size_t length = 0;
+    for (const Wav &wav : p.wavs) length = std::max(length, wav.Length());
+    if (seconds > 0) length = (size_t) (seconds * 48000);
+    if (length == 0) length = 10 * 48000;
+
+    for (Card &c : p.cards)
+    {
+        memset(&c.in, 0, sizeof(c.in));
+        for (int k = 0; k < 3; k++) c.in.knobs[k] = 2048;
+        for (int j = 0; j < 6; j++) c.in.connected[j] = c.connected[j];
+        c.in.switchVal = ComputerCard::Middle;
+        c.in.quality = ComputerCard::Full;
+    }
+
+    std::vector<int16_t> out(length * p.outputs.size());
+    std::vector<double> patchMicros;
+    if (profile) patchMicros.reserve(length);
+    size_t nextEvent = 0;
+    for (size_t n = 0; n < length; n++)
+    {
+        for (; nextEvent < p.events.size() && p.events[nextEvent].sample <= n; nextEvent++)
+        {
+            const Event &e = p.events[nextEvent];
+            ComputerCard::TraceInputs &in = p.cards[e.card].in;
+            if (e.control == switchControl) in.switchVal = (ComputerCard::Switch) e.value;
+            else in.knobs[e.control] = std::max(0, std::min(4095, e.value));
+        }
+
+        // Gather every card's inputs before any card runs, so that all see sample n-1
+        uint32_t sampleTime = ComputerCard::TraceSampleTime(n);
+        for (Card &c : p.cards)
+        {
+            c.in.sampleTime = sampleTime;
+            for (int i = 0; i < 2; i++)
+            {
+                int32_t audio = c.connected[ComputerCard::Audio1 + i] ? SourceLevel(p, c.inputs[ComputerCard::Audio1 + i], n) : 0;
+                int32_t cv = c.connected[ComputerCard::CV1 + i] ? SourceLevel(p, c.inputs[ComputerCard::CV1 + i], n) : 0;
+                c.in.audio[i] = std::max(-2048, std::min(2047, audio));
+                c.in.cv[i] = std::max(-2048, std::min(2047, cv));
+
+                int pulse = ComputerCard::Pulse1 + i;
+                bool high = c.connected[pulse] && SourceLevel(p, c.inputs[pulse], n) > pulseThreshold;
+                c.in.pulse[i] = high;
+                c.in.numEdges[i] = 0;
+                if (high != c.lastPulseIn[i])
+                {
+                    c.in.edges[i][0] = {sampleTime, high};
+                    c.in.numEdges[i] = 1;
+                    c.lastPulseIn[i] = high;
+                }
+            }
+        }
+
+        double total = 0;
+        for (Card &c : p.cards)
+        {
+            int16_t audioOut[2];
+            int32_t cvOut[2];
+            bool pulseOut[2];
+            auto start = std::chrono::steady_clock::now();
+            c.card->ReplaySample(c.in, audioOut, cvOut, pulseOut);
+            if (profile)
+            {
+                std::chrono::duration<double, std::micro> t = std::chrono::steady_clock::now() - start;
+                c.totalMicros += t.count();
+                c.maxMicros = std::max(c.maxMicros, t.count());
+                total += t.count();
+            }
+
+            for (int i = 0; i < 2; i++)
+            {
+                c.out[ComputerCard::Audio1 + i] = std::max(-2048, std::min(2047, (int32_t) audioOut[i]));
+                c.out[ComputerCard::CV1 + i] = std::max(-2048, std::min(2047, cvOut[i] >> 7));
+                c.out[ComputerCard::Pulse1 + i] = pulseOut[i] ? pulseHigh : 0;
+            }
+        }
+        if (profile) patchMicros.push_back(total);
+
+        for (size_t o = 0; o < p.outputs.size(); o++)
+        {
+            // Sources read here are this sample's outputs; WAV channels are this sample's too
+            out[n * p.outputs.size() + o] = SourceLevel(p, p.outputs[o], n) * 16;
+        }
+    }
+
+    if (!WriteWav(outPath, out, p.outputs.size()))
+    {
+        fprintf(stderr, "%s: can't write\n", outPath);
+        return 1;
+    }
+    printf("%zu cards, %zu samples (%.2fs) -> %s\n", p.cards.size(), length, length / 48000.0, outPath);
+
+    if (profile)
+    {
+        // The patch's worst sample, and its mean: what a combined firmware would need per sample
+        double sum = 0;
+        for (double t : patchMicros) sum += t;
+        std::sort(patchMicros.begin(), patchMicros.end());
+        printf("Cost per sample (host microseconds):\n");
+        printf("  %-12s %-11s %8s %8s %6s\n", "card", "type", "mean", "max", "share");
+        for (const Card &c : p.cards)
+        {
+            printf("  %-12s %-11s %8.3f %8.3f %5.1f%%\n", c.name.c_str(), c.type.c_str(),
+                   c.totalMicros / length, c.maxMicros, sum > 0 ? 100 * c.totalMicros / sum : 0.0);
+        }
+        printf("  %-24s %8.3f %8.3f  (99.9th percentile %.3f)\n", "patch", sum / length,
+               patchMicros.back(), patchMicros[std::min(length - 1, length * 999 / 1000)]);
+    }
+    return 0;
+}
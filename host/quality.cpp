@@ -0,0 +1,415 @@
+/*
+Audio quality report for the delay and resonator cards, for every mode
+
+usage: quality_report [report.md] [--threads N]
+
+Renders each mode with test signals and measures, from FFTs of the output:
+
+  Delay (AudioDelay), echo modes, Audio Out 1, fully wet, shortest delay time:
+    frequency response, sine in at -12dBFS, no feedback
+    THD+N, 1kHz in, with no feedback and with 75% feedback (Y at 12 o'clock)
+    aliasing: the largest non-harmonic spur, 7109Hz in at -6dBFS, 75% feedback
+    feedback loop noise floor: what's left 4-5s after a noise burst, at 75% and 94%
+
+  Delay, modulation modes, Audio Out 1, fully wet, slowest LFO, 1/8 depth, with
+  the tone measured around the LFO's first peak:
+    frequency response, sine in at -12dBFS
+    THD (harmonics only, as the sweep moves the pitch), 1kHz in at -6dBFS
+
+  Resonator (ResonatingStrings), fully wet, longest sustain, plucked:
+    tuning error of each string, in cents, against the ratios of its ChordMode,
+    at 25 pitches across the X knob range (C1 to C7, the ExpDelay table range)
+
+The report is markdown, written to stdout if no file is given.
+*/
+
+#include "../delay/AudioDelay.h"
+#include "../resonator/ResonatingStrings.h"
+#include "Analysis.h"
+#include "Render.h"
+#include "ThreadPool.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+// The echo modes, and the switch presses that select each. The modulation modes
+// sweep the delay time, so they are measured apart, while the sweep is at its
+// slowest; the looper and beat repeat need pulses, so they are left out.
+static const char *delayModeNames[] = {"CLEAN", "SATURATION", "SHIMMER", "LOFI", "DIFFUSE"};
+static const int delayModePresses[] = {0, 1, 2, 3, 9};
+static const int numDelayModes = 5;
+
+static const char *modModeNames[] = {"CHORUS", "FLANGER", "VIBRATO"};
+static const int modModePresses[] = {4, 5, 6};
+static const int numModModes = 3;
+
+static const char *chordModeNames[] = {"HARMONIC", "FIFTH", "MAJOR7", "MINOR7", "DIM", "SUS4", "ADD9",
+                                       "TANPURA_PA", "TANPURA_MA", "TANPURA_NI", "TANPURA_NI_KOMAL"};
+static const int numChordModes = 11;
+
+// Intended string frequency ratios, as documented by ResonatingStrings::ChordMode
+static const double chordRatios[numChordModes][4] = {
+    {1, 2, 3, 4},
+    {1, 3.0 / 2, 2, 3},
+    {1, 5.0 / 4, 3.0 / 2, 15.0 / 8},
+    {1, 6.0 / 5, 3.0 / 2, 9.0 / 5},
+    {1, 6.0 / 5, 36.0 / 25, 3.0 / 2},
+    {1, 4.0 / 3, 3.0 / 2, 2},
+    {1, 5.0 / 4, 3.0 / 2, 9.0 / 4},
+    {1, 3.0 / 2, 2, 4},
+    {1, 4.0 / 3, 2, 4},
+    {1, 15.0 / 8, 2, 4},
+    {1, 9.0 / 5, 2, 4},
+};
+
+// Delay measurements
+static const double responseFreqs[] = {31.5, 63, 125, 250, 500, 1000, 2000, 4000, 8000, 12000, 16000, 20000};
+static const int numResponseFreqs = sizeof(responseFreqs) / sizeof(responseFreqs[0]);
+static const size_t toneSkip = 48000; // after the tone starts, for the delay line, feedback and DIFFUSE's allpasses to settle
+static const size_t toneLength = 16384;
+static const double aliasFreq = 7109; // harmonics 4 and up fold back between the ones below Nyquist
+
+// Modulation measurements: with X at minimum the LFO runs at 0.05Hz, and peaks a
+// quarter cycle (5s) after CHORUS is entered, a few hundred samples into the
+// render. Around there the sines are all but still; FLANGER's triangle turns at
+// full slope, which at 1/8 depth shifts 20kHz by under a bin.
+static const size_t modPeak = 240000;
+static const size_t modSkip = modPeak - renderSettleSamples - toneLength / 2;
+
+enum DelayTest {ThdDry, ThdFeedback, Alias, NoiseFeedback, NoiseHighFeedback, numDelayTests};
+
+// Resonator measurements
+static const int numPitches = 25;
+static const size_t pluckSkip = 2400;
+static const size_t pluckLength = 65536;
+static const double searchCents = 100; // how far from the intended frequency to look for a string
+static const double c1Freq = 32.7032; // ExpDelay table base (1468 samples), pitch CV 6 * 341 = 2046
+static const double maxStringFreq = 48000.0 / 10; // strings are at least 10 samples long
+
+static const double notMeasured = 1e9;
+
+// String 1's intended frequency at pitch CV p: the period ExpDelay gives, Q8, so
+// that its table base at 2046 and its clamp at 4091 are allowed for
+static double StringFrequency(int p)
+{
+    return sampleRate * 256 / ExpDelay(p);
+}
+
+static RenderSettings DelaySettings(int mode, int feedbackKnob)
+{
+    RenderSettings s;
+    s.knobs[0] = 4095; // fully wet
+    s.knobs[1] = 0; // 100 samples
+    s.knobs[2] = feedbackKnob;
+    s.modePresses = delayModePresses[mode];
+    return s;
+}
+
+static RenderSettings ToneSettings(int mode, int feedbackKnob, double freq, double level)
+{
+    RenderSettings s = DelaySettings(mode, feedbackKnob);
+    s.stimulus = RenderSettings::Sine;
+    s.frequency = freq;
+    s.level = level;
+    s.seconds = (toneSkip + toneLength) / sampleRate + 0.01;
+    return s;
+}
+
+// Output of a delay render, Audio Out 1 only: SATURATION and SHIMMER offset the
+// right channel's delay time, which would comb filter a mono mix
+static std::vector<double> DelayOut(const RenderSettings &s)
+{
+    RenderResult r = Render<AudioDelay>(s);
+    return std::vector<double>(r.out[0].begin() + r.start, r.out[0].end());
+}
+
+static double DelayTestValue(int mode, DelayTest test)
+{
+    switch (test)
+    {
+    case ThdDry:
+        return Decibels(ThdPlusNoise(DelayOut(ToneSettings(mode, 0, 1000, 0.5)), toneSkip, toneLength, 1000));
+    case ThdFeedback:
+        return Decibels(ThdPlusNoise(DelayOut(ToneSettings(mode, 2048, 1000, 0.25)), toneSkip, toneLength, 1000));
+    case Alias:
+        return Decibels(SpurLevel(DelayOut(ToneSettings(mode, 2048, aliasFreq, 0.5)), toneSkip, toneLength, aliasFreq));
+    case NoiseFeedback:
+    case NoiseHighFeedback:
+    {
+        RenderSettings s = DelaySettings(mode, test == NoiseFeedback ? 2048 : 3072);
+        s.stimulus = RenderSettings::Noise;
+        s.seconds = 5;
+        std::vector<double> out = DelayOut(s);
+        double rms = Rms(out, out.size() - 48000);
+        return rms > 0 ? Decibels(rms) : -notMeasured;
+    }
+    default:
+        return 0;
+    }
+}
+
+static RenderSettings ModToneSettings(int mode, double freq, double level)
+{
+    RenderSettings s;
+    s.knobs[0] = 4095; // fully wet
+    s.knobs[1] = 0; // slowest LFO
+    s.knobs[2] = 512; // 1/8 depth
+    s.modePresses = modModePresses[mode];
+    s.stimulus = RenderSettings::Sine;
+    s.frequency = freq;
+    s.level = level;
+    s.seconds = (modSkip + toneLength) / sampleRate + 0.01;
+    return s;
+}
+
+struct StringTuning
+{
+    double cents[4]; // notMeasured if the string couldn't be measured
+    bool clamped[4]; // intended frequency beyond the shortest string
+};
+
+// Pluck the strings at pitch CV p, and find each one's frequency. String 1 is
+// measured alone in tuning mode (switch up); string 3 by subtracting it from the
+// sum of outputs (strings 1 and 3); strings 2 and 4 from the difference (2 and 4),
+// unless string 4 falls within reach of one of string 2's harmonics.
+static StringTuning MeasureTuning(int mode, int p)
+{
+    RenderSettings s;
+    s.knobs[0] = 4095;
+    s.knobs[1] = (p - 2048) * 2;
+    s.knobs[2] = 4095;
+    s.modePresses = mode;
+    s.stimulus = RenderSettings::Silence;
+    s.pluck = true;
+    s.seconds = (pluckSkip + pluckLength) / sampleRate + 0.01;
+
+    s.switchVal = ComputerCard::Up;
+    RenderResult alone = Render<ResonatingStrings>(s);
+    s.switchVal = ComputerCard::Middle;
+    RenderResult mixed = Render<ResonatingStrings>(s);
+
+    size_t n = alone.out[0].size();
+    std::vector<double> strings[3]; // string 1, strings 2 and 4, string 3
+    for (int i = 0; i < 3; i++) strings[i].resize(n);
+    for (size_t t = 0; t < n; t++)
+    {
+        double sum = 0.5 * (mixed.out[0][t] + mixed.out[1][t]), diff = 0.5 * (mixed.out[0][t] - mixed.out[1][t]);
+        strings[0][t] = alone.out[0][t];
+        strings[2][t] = sum - alone.out[0][t];
+        strings[1][t] = diff;
+    }
+
+    double f0 = StringFrequency(p);
+    StringTuning result;
+    std::vector<double> spectra[3];
+    for (int i = 0; i < 3; i++) spectra[i] = PaddedSpectrum(strings[i], alone.start + pluckSkip, pluckLength);
+    for (int i = 0; i < 4; i++)
+    {
+        double target = f0 * chordRatios[mode][i];
+        result.clamped[i] = target > maxStringFreq;
+        result.cents[i] = notMeasured;
+
+        if (i == 3)
+        {
+            double harmonic = std::round(chordRatios[mode][3] / chordRatios[mode][1]);
+            double nearest = harmonic * chordRatios[mode][1];
+            if (std::fabs(1200 * std::log2(chordRatios[mode][3] / nearest)) < 2 * searchCents) continue;
+        }
+        double found = PeakFrequency(spectra[i == 3 ? 1 : i], target, searchCents);
+        if (found > 0 && !result.clamped[i]) result.cents[i] = 1200 * std::log2(found / target);
+    }
+    return result;
+}
+
+static int PitchCV(int k)
+{
+    return 2048 + 2047 * k / (numPitches - 1);
+}
+
+static void PrintCents(FILE *f, const StringTuning &t, int i)
+{
+    if (t.clamped[i]) fprintf(f, " clamped |");
+    else if (t.cents[i] == notMeasured) fprintf(f, " - |");
+    else fprintf(f, " %+.1f |", t.cents[i]);
+}
+
+int main(int argc, char **argv)
+{
+    unsigned threads = std::thread::hardware_concurrency();
+    const char *outPath = nullptr;
+    bool ok = true;
+    for (int i = 1; i < argc && ok; i++)
+    {
+        if (!strcmp(argv[i], "--threads") && i + 1 < argc) threads = atoi(argv[++i]);
+        else if (argv[i][0] != '-' && !outPath) outPath = argv[i];
+        else ok = false;
+    }
+    if (!ok)
+    {
+        fprintf(stderr, "usage: %s [report.md] [--threads N]\n", argv[0]);
+        return 2;
+    }
+
+    // Every render is a job, writing its own result
+    double response[numDelayModes][numResponseFreqs];
+    double delayTests[numDelayModes][numDelayTests];
+    double modResponse[numModModes][numResponseFreqs];
+    double modThd[numModModes];
+    StringTuning tuning[numChordModes][numPitches];
+    std::vector<std::function<void()>> jobs;
+    for (int m = 0; m < numDelayModes; m++)
+    {
+        for (int k = 0; k < numResponseFreqs; k++)
+        {
+            jobs.push_back([&, m, k] {
+                double level = 0.25, f = responseFreqs[k];
+                std::vector<double> out = DelayOut(ToneSettings(m, 0, f, level));
+                response[m][k] = Decibels(ToneAmplitude(out, toneSkip, toneLength, f) / (level * 2047 / 2048));
+            });
+        }
+        for (int t = 0; t < numDelayTests; t++)
+        {
+            jobs.push_back([&, m, t] { delayTests[m][t] = DelayTestValue(m, (DelayTest) t); });
+        }
+    }
+    for (int m = 0; m < numModModes; m++)
+    {
+        for (int k = 0; k < numResponseFreqs; k++)
+        {
+            jobs.push_back([&, m, k] {
+                double level = 0.25, f = responseFreqs[k];
+                std::vector<double> out = DelayOut(ModToneSettings(m, f, level));
+                modResponse[m][k] = Decibels(ToneAmplitude(out, modSkip, toneLength, f) / (level * 2047 / 2048));
+            });
+        }
+        jobs.push_back([&, m] {
+            modThd[m] = Decibels(Thd(DelayOut(ModToneSettings(m, 1000, 0.5)), modSkip, toneLength, 1000));
+        });
+    }
+    for (int m = 0; m < numChordModes; m++)
+    {
+        for (int k = 0; k < numPitches; k++)
+        {
+            jobs.push_back([&, m, k] { tuning[m][k] = MeasureTuning(m, PitchCV(k)); });
+        }
+    }
+    ParallelFor(jobs.size(), threads, [&](size_t i) { jobs[i](); });
+
+    FILE *f = outPath ? fopen(outPath, "w") : stdout;
+    if (!f)
+    {
+        fprintf(stderr, "%s: can't write\n", outPath);
+        return 1;
+    }
+
+    fprintf(f, "# Audio quality report\n\n");
+    fprintf(f, "## Delay\n\n");
+    fprintf(f, "Audio Out 1, mix fully wet, delay time at minimum (100 samples).\n\n");
+    fprintf(f, "### Frequency response (dB), -12dBFS sine, no feedback\n\n| Hz |");
+    for (int m = 0; m < numDelayModes; m++) fprintf(f, " %s |", delayModeNames[m]);
+    fprintf(f, "\n|---:|");
+    for (int m = 0; m < numDelayModes; m++) fprintf(f, "---:|");
+    fprintf(f, "\n");
+    for (int k = 0; k < numResponseFreqs; k++)
+    {
+        fprintf(f, "| %g |", responseFreqs[k]);
+        for (int m = 0; m < numDelayModes; m++) fprintf(f, " %+.2f |", response[m][k]);
+        fprintf(f, "\n");
+    }
+
+    static const char *testNames[numDelayTests] = {
+        "THD+N (dB), 1kHz at -6dBFS, no feedback",
+        "THD+N (dB), 1kHz at -12dBFS, 75% feedback",
+        "Largest non-harmonic spur (dBc), 7109Hz at -6dBFS, 75% feedback",
+        "Residual 4-5s after a noise burst, DC included (dBFS), 75% feedback",
+        "Residual 4-5s after a noise burst, DC included (dBFS), 94% feedback",
+    };
+    fprintf(f, "\n### Distortion and noise\n\n| |");
+    for (int m = 0; m < numDelayModes; m++) fprintf(f, " %s |", delayModeNames[m]);
+    fprintf(f, "\n|---|");
+    for (int m = 0; m < numDelayModes; m++) fprintf(f, "---:|");
+    fprintf(f, "\n");
+    for (int t = 0; t < numDelayTests; t++)
+    {
+        fprintf(f, "| %s |", testNames[t]);
+        for (int m = 0; m < numDelayModes; m++)
+        {
+            if (delayTests[m][t] == -notMeasured) fprintf(f, " silent |");
+            else fprintf(f, " %.1f |", delayTests[m][t]);
+        }
+        fprintf(f, "\n");
+    }
+
+    fprintf(f, "\n### Modulation modes\n\n");
+    fprintf(f, "X at minimum (0.05Hz LFO), Y at 1/8 (depth), measured over %zu samples centred\n"
+               "on the LFO's first peak, where the delay is longest. FLANGER's feedback makes a\n"
+               "comb of its response.\n\n| |", toneLength);
+    for (int m = 0; m < numModModes; m++) fprintf(f, " %s |", modModeNames[m]);
+    fprintf(f, "\n|---|");
+    for (int m = 0; m < numModModes; m++) fprintf(f, "---:|");
+    fprintf(f, "\n");
+    for (int k = 0; k < numResponseFreqs; k++)
+    {
+        fprintf(f, "| Response (dB), %gHz at -12dBFS |", responseFreqs[k]);
+        for (int m = 0; m < numModModes; m++) fprintf(f, " %+.2f |", modResponse[m][k]);
+        fprintf(f, "\n");
+    }
+    fprintf(f, "| THD (dB), harmonics 2-10, 1kHz at -6dBFS |");
+    for (int m = 0; m < numModModes; m++) fprintf(f, " %.1f |", modThd[m]);
+    fprintf(f, "\n");
+
+    fprintf(f, "\n## Resonator\n\n");
+    fprintf(f, "Tuning error in cents against the ChordMode ratios, plucked on Pulse In 1, mix fully wet,\n"
+               "Y at maximum, at %d pitches from C1 (%.2fHz) to C7 on the X knob. \"clamped\": above\n"
+               "%.0fHz, where the string can't be shorter; \"-\": not measured (no peak within %.0f cents,\n"
+               "or string 4 on a harmonic of string 2).\n\n", numPitches, c1Freq, maxStringFreq, searchCents);
+    fprintf(f, "### Summary by mode\n\n| Mode | max abs | mean abs | measured | clamped | not measured |\n");
+    fprintf(f, "|---|---:|---:|---:|---:|---:|\n");
+    for (int m = 0; m < numChordModes; m++)
+    {
+        double maxAbs = 0, sumAbs = 0;
+        int measured = 0, clamped = 0, missing = 0;
+        for (int k = 0; k < numPitches; k++)
+        {
+            for (int i = 0; i < 4; i++)
+            {
+                const StringTuning &t = tuning[m][k];
+                if (t.clamped[i]) clamped++;
+                else if (t.cents[i] == notMeasured) missing++;
+                else
+                {
+                    maxAbs = std::max(maxAbs, std::fabs(t.cents[i]));
+                    sumAbs += std::fabs(t.cents[i]);
+                    measured++;
+                }
+            }
+        }
+        fprintf(f, "| %s | %.1f | %.1f | %d | %d | %d |\n", chordModeNames[m], maxAbs,
+                measured ? sumAbs / measured : 0.0, measured, clamped, missing);
+    }
+
+    for (int m = 0; m < numChordModes; m++)
+    {
+        fprintf(f, "\n### %s\n\n| pitch CV | string 1 Hz | 1 | 2 | 3 | 4 |\n|---:|---:|---:|---:|---:|---:|\n",
+                chordModeNames[m]);
+        for (int k = 0; k < numPitches; k++)
+        {
+            int p = PitchCV(k);
+            fprintf(f, "| %d | %.1f |", p, StringFrequency(p));
+            for (int i = 0; i < 4; i++) PrintCents(f, tuning[m][k], i);
+            fprintf(f, "\n");
+        }
+    }
+
+    if (outPath)
+    {
+        fclose(f);
+        printf("%zu renders on %u threads -> %s\n", jobs.size(), threads, outPath);
+    }
+    return 0;
+}
@@ -0,0 +1,302 @@
+/*
+Replay a control trace through a card on the host
+
+Reads a trace printed over USB serial by a card built with COMPUTERCARD_TRACE_SIZE
+(see ComputerCard::TraceField), feeds it sample by sample into the same card class
+with ReplaySample, and writes the card's outputs to a 4-channel 16-bit WAV file:
+Audio Out 1, Audio Out 2, CV Out 1, CV Out 2.
+
+usage: replay_<card> trace.txt out.wav [--input in.wav] [--profile]
+
+  --input    audio inputs, for traces recorded without COMPUTERCARD_TRACE_AUDIO
+             (mono or stereo 16-bit WAV, top 12 bits used)
+  --profile  time each ProcessSample, and list the slowest samples
+*/
+
+#include CARD_HEADER
+#include "Wav.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+struct Trace
+{
+    uint32_t samples = 0;
+    bool hasAudio = false;
+    std::vector<uint8_t> bytes;
+};
+
+// Read the last complete TRACE ... END block in a serial log
+static bool ReadTrace(const char *path, Trace &trace)
+{
+    std::ifstream in(path);
+    if (!in) return false;
+
+    bool found = false, inBlock = false;
+    Trace block;
+    unsigned long declaredBytes = 0;
+    std::string line;
+    while (std::getline(in, line))
+    {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+
+        unsigned version, samples, audio;
+        if (sscanf(line.c_str(), "TRACE %u %u %lu %u", &version, &samples, &declaredBytes, &audio) == 4 && version == 1)
+        {
+            block = Trace();
+            block.samples = samples;
+            block.hasAudio = audio;
+            inBlock = true;
+        }
+        else if (inBlock && line == "END")
+        {
+            inBlock = false;
+            if (block.bytes.size() == declaredBytes)
+            {
+                trace = block;
+                found = true;
+            }
+        }
+        else if (inBlock)
+        {
+            for (size_t i = 0; i + 1 < line.size(); i += 2)
+            {
+                block.bytes.push_back((uint8_t) strtoul(line.substr(i, 2).c_str(), nullptr, 16));
+            }
+        }
+    }
+    return found;
+}
+
+// Decodes trace entries into the per-sample inputs for ReplaySample
+class TraceDecoder
+{
+public:
+    explicit TraceDecoder(const Trace &trace) : bytes(trace.bytes)
+    {
+        memset(&inputs, 0, sizeof(inputs));
+        memset(last, 0, sizeof(last));
+        ReadTag();
+    }
+
+    // Apply entries for sample n, which must follow the previous call's
+    const ComputerCard::TraceInputs &Inputs(uint32_t n)
+    {
+        inputs.numEdges[0] = inputs.numEdges[1] = 0;
+        inputs.sampleTime = ComputerCard::TraceSampleTime(n);
+        while (havePending && pendingSample == n)
+        {
+            Apply();
+            ReadTag();
+        }
+        return inputs;
+    }
+
+    bool Error() const {return error;}
+
+private:
+    const std::vector<uint8_t> &bytes;
+    size_t pos = 0;
+    bool error = false;
+
+    ComputerCard::TraceInputs inputs;
+    int32_t last[ComputerCard::numTraceFields];
+
+    bool havePending = false;
+    int pendingField = 0;
+    uint32_t pendingSample = 0;
+
+    uint32_t Varint()
+    {
+        uint32_t x = 0;
+        for (int shift = 0; pos < bytes.size(); shift += 7)
+        {
+            uint8_t b = bytes[pos++];
+            x |= (uint32_t) (b & 0x7F) << shift;
+            if (!(b & 0x80)) return x;
+        }
+        error = true;
+        return 0;
+    }
+
+    static int32_t Unzigzag(uint32_t x) {return (int32_t) (x >> 1) ^ -(int32_t) (x & 1);}
+
+    void ReadTag()
+    {
+        havePending = false;
+        if (pos >= bytes.size()) return;
+        uint8_t tag = bytes[pos++];
+        uint32_t dt = tag & 0x0F;
+        if (dt == 15) dt += Varint();
+        pendingField = tag >> 4;
+        pendingSample += dt;
+        havePending = !error;
+    }
+
+    void Apply()
+    {
+        using CC = ComputerCard;
+        int f = pendingField;
+        if (f < CC::TraceSwitch)
+        {
+            last[f] += Unzigzag(Varint());
+        }
+        else if (f == CC::TracePulseEdge1 || f == CC::TracePulseEdge2)
+        {
+            uint32_t x = Varint();
+            int i = f - CC::TracePulseEdge1;
+            if (inputs.numEdges[i] < CC::pulseEdgeQueueSize)
+            {
+                inputs.edges[i][inputs.numEdges[i]++] = {inputs.sampleTime + Unzigzag(x >> 1), (bool) (x & 1)};
+            }
+            return;
+        }
+        else if (f < CC::numTraceFields && pos < bytes.size())
+        {
+            last[f] = bytes[pos++];
+        }
+        else
+        {
+            error = true;
+            return;
+        }
+
+        switch (f)
+        {
+        case CC::TraceKnobMain: case CC::TraceKnobX: case CC::TraceKnobY:
+            inputs.knobs[f - CC::TraceKnobMain] = last[f];
+            break;
+        case CC::TraceCV1: case CC::TraceCV2:
+            inputs.cv[f - CC::TraceCV1] = last[f];
+            break;
+        case CC::TraceAudio1: case CC::TraceAudio2:
+            inputs.audio[f - CC::TraceAudio1] = last[f];
+            break;
+        case CC::TraceSwitch:
+            inputs.switchVal = (CC::Switch) last[f];
+            break;
+        case CC::TracePulse:
+            inputs.pulse[0] = last[f] & 1;
+            inputs.pulse[1] = last[f] & 2;
+            break;
+        case CC::TraceConnected:
+            for (int i = 0; i < 6; i++) inputs.connected[i] = (last[f] >> i) & 1;
+            break;
+        case CC::TraceQuality:
+            inputs.quality = (CC::Quality) last[f];
+            break;
+        }
+    }
+};
+
+
+int main(int argc, char **argv)
+{
+    const char *tracePath = nullptr, *outPath = nullptr, *inputPath = nullptr;
+    bool profile = false;
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "--input") && i + 1 < argc) inputPath = argv[++i];
+        else if (!strcmp(argv[i], "--profile")) profile = true;
+        else if (!tracePath) tracePath = argv[i];
+        else if (!outPath) outPath = argv[i];
+        else tracePath = nullptr, i = argc;
+    }
+    if (!tracePath || !outPath)
+    {
+        fprintf(stderr, "usage: %s trace.txt out.wav [--input in.wav] [--profile]\n", argv[0]);
+        return 2;
+    }
+
+    Trace trace;
+    if (!ReadTrace(tracePath, trace))
+    {
+        fprintf(stderr, "%s: no complete trace found\n", tracePath);
+        return 1;
+    }
+
+    std::vector<int16_t> input;
+    int inputChannels = 0;
+    if (inputPath)
+    {
+        if (trace.hasAudio) fprintf(stderr, "warning: trace includes audio inputs, ignoring --input\n");
+        else if (!ReadWav(inputPath, input, inputChannels))
+        {
+            fprintf(stderr, "%s: can't read 16-bit PCM WAV\n", inputPath);
+            return 1;
+        }
+    }
+    else if (!trace.hasAudio)
+    {
+        fprintf(stderr, "warning: trace has no audio inputs and no --input given, using silence\n");
+    }
+
+    static CARD_CLASS card;
+    ComputerCard::ConfigureInterpolators();
+
+    TraceDecoder decoder(trace);
+    std::vector<int16_t> out(trace.samples * 4);
+    std::vector<std::pair<double, uint32_t>> times;
+    if (profile) times.reserve(trace.samples);
+
+    for (uint32_t n = 0; n < trace.samples; n++)
+    {
+        ComputerCard::TraceInputs inputs = decoder.Inputs(n);
+        if (inputChannels && !trace.hasAudio)
+        {
+            size_t frame = (size_t) n * inputChannels;
+            for (int i = 0; i < 2; i++)
+            {
+                size_t s = frame + (inputChannels > 1 ? i : 0);
+                inputs.audio[i] = s < input.size() ? input[s] >> 4 : 0;
+            }
+        }
+
+        int16_t audioOut[2];
+        int32_t cvOut[2];
+        auto start = std::chrono::steady_clock::now();
+        card.ReplaySample(inputs, audioOut, cvOut);
+        if (profile)
+        {
+            std::chrono::duration<double, std::micro> t = std::chrono::steady_clock::now() - start;
+            times.push_back({t.count(), n});
+        }
+
+        for (int i = 0; i < 2; i++)
+        {
+            int32_t a = std::max(-2048, std::min(2047, (int32_t) audioOut[i]));
+            out[n * 4 + i] = a * 16;
+            out[n * 4 + 2 + i] = cvOut[i] >> 3;
+        }
+    }
+
+    if (decoder.Error())
+    {
+        fprintf(stderr, "%s: trace is corrupt\n", tracePath);
+        return 1;
+    }
+    if (!WriteWav(outPath, out, 4))
+    {
+        fprintf(stderr, "%s: can't write\n", outPath);
+        return 1;
+    }
+    printf("%u samples (%.2fs), %zu trace bytes -> %s\n", trace.samples, trace.samples / 48000.0, trace.bytes.size(), outPath);
+
+    if (profile && !times.empty())
+    {
+        int top = std::min<int>(10, times.size());
+        std::partial_sort(times.begin(), times.begin() + top, times.end(), std::greater<>());
+        printf("Slowest samples (host microseconds):\n");
+        for (int i = 0; i < top; i++)
+        {
+            printf("  sample %8u (%9.4fs)  %8.3f\n", times[i].second, times[i].second / 48000.0, times[i].first);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,185 @@
+/*
+Render a card over a grid of control settings, on all CPU cores, and summarise each
+
+usage: sweep_<card> out.csv [options]
+
+  --main R, --x R, --y R   knob positions, 0-4095 (default 2048)
+  --cv1 R, --cv2 R         CV inputs, -2048-2047 (default unplugged)
+  --mode R                 switch Down presses before the stimulus (default 0)
+  --switch down|middle|up  switch position during the render (default middle)
+  --input impulse|noise|sine:<Hz>|silence   test input (default impulse)
+  --level L                input level, fraction of full scale (default 0.5)
+  --pluck                  pulse on Pulse In 1 as the input starts
+  --seconds S              render length after the input starts (default 2)
+  --threads N              default: all cores
+
+R is a value, or start:end:count for count evenly spaced values. Every combination
+is rendered from a newly constructed card, on one thread; cards on different threads
+share no state (see ComputerCard::ReplaySample), so the output doesn't depend on
+--threads. Each CSV row has the settings, then
+the RMS and peak level (dBFS), decay time to -60dB (s, -1 if it doesn't), and
+spectral centroid (Hz) of the mono output from the start of the input.
+*/
+
+#include CARD_HEADER
+#include "Analysis.h"
+#include "Render.h"
+#include "ThreadPool.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Parse "v" or "start:end:count"
+static bool ParseRange(const char *arg, std::vector<int> &values)
+{
+    int start, end, count;
+    char extra;
+    values.clear();
+    if (sscanf(arg, "%d:%d:%d%c", &start, &end, &count, &extra) == 3 && count >= 1)
+    {
+        for (int i = 0; i < count; i++)
+        {
+            values.push_back(count == 1 ? start : start + (int) ((int64_t) (end - start) * i / (count - 1)));
+        }
+        return true;
+    }
+    if (sscanf(arg, "%d%c", &start, &extra) == 1)
+    {
+        values.push_back(start);
+        return true;
+    }
+    return false;
+}
+
+enum Param {Main, X, Y, CV1, CV2, Mode, numParams};
+static const char *paramNames[numParams] = {"main", "x", "y", "cv1", "cv2", "mode"};
+
+struct Metrics
+{
+    double rmsDb, peakDb, decay, centroid;
+};
+
+int main(int argc, char **argv)
+{
+    std::vector<int> values[numParams] = {{2048}, {2048}, {2048}, {0}, {0}, {0}};
+    bool cvSet[2] = {false, false};
+    RenderSettings base;
+    unsigned threads = std::thread::hardware_concurrency();
+    const char *outPath = nullptr;
+
+    bool ok = true;
+    for (int i = 1; i < argc && ok; i++)
+    {
+        const char *a = argv[i];
+        const char *v = i + 1 < argc ? argv[i + 1] : nullptr;
+        int p = numParams;
+        for (int q = 0; q < numParams; q++)
+        {
+            if (a[0] == '-' && a[1] == '-' && !strcmp(a + 2, paramNames[q])) p = q;
+        }
+
+        if (p < numParams && v)
+        {
+            ok = ParseRange(v, values[p]);
+            if (p == CV1 || p == CV2) cvSet[p - CV1] = true;
+            i++;
+        }
+        else if (!strcmp(a, "--switch") && v)
+        {
+            std::string sw = v;
+            base.switchVal = sw == "down" ? ComputerCard::Down : (sw == "up" ? ComputerCard::Up : ComputerCard::Middle);
+            ok = sw == "down" || sw == "middle" || sw == "up";
+            i++;
+        }
+        else if (!strcmp(a, "--input") && v)
+        {
+            std::string in = v;
+            if (in == "impulse") base.stimulus = RenderSettings::Impulse;
+            else if (in == "noise") base.stimulus = RenderSettings::Noise;
+            else if (in == "silence") base.stimulus = RenderSettings::Silence;
+            else if (in.compare(0, 5, "sine:") == 0)
+            {
+                base.stimulus = RenderSettings::Sine;
+                base.frequency = atof(in.c_str() + 5);
+            }
+            else ok = false;
+            i++;
+        }
+        else if (!strcmp(a, "--level") && v) base.level = atof(argv[++i]);
+        else if (!strcmp(a, "--seconds") && v) base.seconds = atof(argv[++i]);
+        else if (!strcmp(a, "--threads") && v) threads = atoi(argv[++i]);
+        else if (!strcmp(a, "--pluck")) base.pluck = true;
+        else if (a[0] != '-' && !outPath) outPath = a;
+        else ok = false;
+    }
+    for (int m : values[Mode])
+    {
+        if (m < 0 || m > renderMaxModePresses) ok = false;
+    }
+    if (!ok || !outPath)
+    {
+        fprintf(stderr, "usage: %s out.csv [--main R] [--x R] [--y R] [--cv1 R] [--cv2 R] [--mode R]\n"
+            "    [--switch down|middle|up] [--input impulse|noise|sine:<Hz>|silence] [--level L]\n"
+            "    [--pluck] [--seconds S] [--threads N]\n"
+            "R: value or start:end:count; mode: 0-%d\n", argv[0], renderMaxModePresses);
+        return 2;
+    }
+
+    size_t numJobs = 1;
+    for (int p = 0; p < numParams; p++) numJobs *= values[p].size();
+
+    // Job index to grid point, with the last parameter varying fastest
+    auto settingsFor = [&](size_t job, int point[numParams]) {
+        RenderSettings s = base;
+        for (int p = numParams - 1; p >= 0; p--)
+        {
+            point[p] = values[p][job % values[p].size()];
+            job /= values[p].size();
+        }
+        for (int k = 0; k < 3; k++) s.knobs[k] = point[Main + k];
+        for (int c = 0; c < 2; c++)
+        {
+            s.cv[c] = point[CV1 + c];
+            s.cvConnected[c] = cvSet[c];
+        }
+        s.modePresses = point[Mode];
+        return s;
+    };
+
+    std::vector<Metrics> metrics(numJobs);
+    auto startTime = std::chrono::steady_clock::now();
+    ParallelFor(numJobs, threads, [&](size_t job) {
+        int point[numParams];
+        RenderResult r = Render<CARD_CLASS>(settingsFor(job, point));
+        std::vector<double> mono = r.Mono();
+        std::vector<double> tail(mono.begin() + r.start, mono.end());
+        metrics[job] = {Decibels(Rms(tail)), Decibels(Peak(tail)), DecayTime(tail, 0), SpectralCentroid(tail, 0)};
+    });
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - startTime;
+
+    FILE *f = fopen(outPath, "w");
+    if (!f)
+    {
+        fprintf(stderr, "%s: can't write\n", outPath);
+        return 1;
+    }
+    for (int p = 0; p < numParams; p++) fprintf(f, "%s,", paramNames[p]);
+    fprintf(f, "rms_db,peak_db,decay_s,centroid_hz\n");
+    for (size_t job = 0; job < numJobs; job++)
+    {
+        int point[numParams];
+        settingsFor(job, point);
+        for (int p = 0; p < numParams; p++) fprintf(f, "%d,", point[p]);
+        const Metrics &m = metrics[job];
+        fprintf(f, "%.2f,%.2f,%.3f,%.1f\n", m.rmsDb, m.peakDb, m.decay, m.centroid);
+    }
+    fclose(f);
+
+    printf("%zu configurations in %.1fs on %u threads -> %s\n", numJobs, elapsed.count(), threads, outPath);
+    return 0;
+}
@@ -0,0 +1,121 @@
+#ifndef PROGRAMSELECT_H
+#define PROGRAMSELECT_H
+
+#include "ComputerCard.h"
+#include "hardware/adc.h"
+#include "hardware/flash.h"
+#include "hardware/sync.h"
+
+/**
+Boot-time program selection for the multi-card firmware
+
+Runs before any card is constructed, so it reads the switch and Main knob
+directly from the ADC and drives the LEDs as plain GPIO. Holding the switch down
+at power-on enters selection: the Main knob picks a program, in quarters, shown on
+the LEDs, and releasing the switch starts it. The choice is kept in flash, in the
+sector below the calibration cache, and used on later boots.
+*/
+
+// Flash offset of the sector holding the program choice
+#ifndef MULTI_PROGRAM_OFFSET
+#define MULTI_PROGRAM_OFFSET (COMPUTERCARD_CAL_CACHE_OFFSET - FLASH_SECTOR_SIZE)
+#endif
+
+class ProgramSelect
+{
+public:
+    enum Program { DELAY = 0, RESONATOR = 1, HARMONIZER = 2, REVERB = 3, NUM_PROGRAMS = 4 };
+
+    // The program to run: chosen now if the switch is held down, otherwise the saved one
+    static Program Choose() {
+        gpio_init(MX_A);
+        gpio_init(MX_B);
+        gpio_set_dir(MX_A, GPIO_OUT);
+        gpio_set_dir(MX_B, GPIO_OUT);
+        adc_init();
+        adc_gpio_init(MUX_IO_1);
+        adc_select_input(MUX_IO_1 - 26);
+
+        Program saved = Load();
+        if (!switchDown()) return saved;
+
+        for (int i = 0; i < 6; i++) {
+            gpio_init(LED_PIN_0 + i);
+            gpio_set_dir(LED_PIN_0 + i, GPIO_OUT);
+        }
+
+        // Follow the knob until the switch has been released for RELEASE_MS
+        Program program = saved;
+        int releasedMs = 0;
+        while (releasedMs < RELEASE_MS) {
+            program = (Program)(readMux(MUX_MAIN) * NUM_PROGRAMS / 4096);
+            showProgram(program);
+            releasedMs = switchDown() ? 0 : releasedMs + 1;
+            sleep_ms(1);
+        }
+
+        for (int i = 0; i < 6; i++) gpio_put(LED_PIN_0 + i, false);
+        if (program != saved) Save(program);
+        return program;
+    }
+
+private:
+    // Mux states of the Main knob and the switch, read on MUX_IO_1 (ComputerCard.h)
+    static const int MUX_MAIN = 0, MUX_SWITCH = 3;
+    static const uint LED_PIN_0 = 10;
+    static const int RELEASE_MS = 50;  // debounce
+
+    static const uint32_t PROGRAM_MAGIC = 0x50524731;  // "PRG1"
+    struct Saved {
+        uint32_t magic;
+        uint32_t program;
+        uint32_t check;  // ~program
+    };
+
+    static uint16_t readMux(int state) {
+        gpio_put(MX_A, state & 1);
+        gpio_put(MX_B, state & 2);
+        sleep_us(20);  // settle
+        uint32_t sum = 0;
+        for (int i = 0; i < 16; i++) sum += adc_read();
+        return sum >> 4;
+    }
+
+    // As ComputerCard::SwitchVal: below 1000 is down
+    static bool switchDown() {
+        return readMux(MUX_SWITCH) < 1000;
+    }
+
+    // Program 0 lights the top row of LEDs, 1 the middle, 2 the bottom, 3 the left column
+    static void showProgram(Program program) {
+        static const uint8_t programLeds[NUM_PROGRAMS] = {0x03, 0x0C, 0x30, 0x15};
+        for (int i = 0; i < 6; i++) gpio_put(LED_PIN_0 + i, (programLeds[program] >> i) & 1);
+    }
+
+    static Program Load() {
+        const Saved *saved = (const Saved *)(XIP_BASE + MULTI_PROGRAM_OFFSET);
+        if (saved->magic != PROGRAM_MAGIC || saved->check != ~saved->program || saved->program >= NUM_PROGRAMS) {
+            return DELAY;
+        }
+        return (Program)saved->program;
+    }
+
+    // Before any card, so nothing else depends on flash yet
+    static void Save(Program program) {
+        union {
+            Saved saved;
+            uint8_t bytes[FLASH_PAGE_SIZE];
+        } page;
+        for (unsigned i = 0; i < FLASH_PAGE_SIZE; i++) page.bytes[i] = 0xFF;
+        page.saved.magic = PROGRAM_MAGIC;
+        page.saved.program = program;
+        page.saved.check = ~(uint32_t)program;
+
+        uint32_t irq = save_and_disable_interrupts();
+        flash_range_erase(MULTI_PROGRAM_OFFSET, FLASH_SECTOR_SIZE);
+        flash_range_program(MULTI_PROGRAM_OFFSET, page.bytes, FLASH_PAGE_SIZE);
+        restore_interrupts(irq);
+    }
+};
+
+#endif
@@ -0,0 +1,51 @@
+#include "ProgramSelect.h"
+#include "AudioDelay.h"
+#include "ResonatingStrings.h"
+#include "SimplePitchShifter.h"
+#include "FdnReverb.h"
+#include <new>
+
+// Storage for whichever card runs: the cards hold their buffers, so static RAM is
+// that of the largest card, not the sum. Only the chosen member is ever constructed.
+union CardStorage {
+    CardStorage() {}
+    ~CardStorage() {}
+    AudioDelay delay;
+    ResonatingStrings resonator;
+    SimplePitchShifter harmonizer;
+    FdnReverb reverb;
+};
+static CardStorage storage;
+
+int main() {
+    // Each card set up as in its own main.cpp
+    switch (ProgramSelect::Choose()) {
+    case ProgramSelect::RESONATOR: {
+        ResonatingStrings *resonator = new (&storage.resonator) ResonatingStrings;
+        resonator->EnableNormalisationProbe();
+        resonator->EnablePulseInEdgeCapture();
+        resonator->EnableAudioRateCV();
+        resonator->SetCVSmoothing(1);  // light smoothing, for FM up to several kHz
+        resonator->Run();
+        break;
+    }
+    case ProgramSelect::HARMONIZER: {
+        SimplePitchShifter *harmonizer = new (&storage.harmonizer) SimplePitchShifter;
+        harmonizer->Run();
+        break;
+    }
+    case ProgramSelect::REVERB: {
+        FdnReverb *reverb = new (&storage.reverb) FdnReverb;
+        reverb->EnableNormalisationProbe();
+        reverb->Run();
+        break;
+    }
+    default: {
+        AudioDelay *delay = new (&storage.delay) AudioDelay;
+        delay->EnablePulseInEdgeCapture();
+        delay->Run();
+        break;
+    }
+    }
+    return 0;
+}
@@ -0,0 +1,222 @@
+#ifndef RESODELAY_H
+#define RESODELAY_H
+
+#include "ComputerCard.h"
+#include "ResonatingStrings.h"
+#include "AudioDelay.h"
+#include "pico/multicore.h"
+#include "hardware/sync.h"
+#ifdef RESODELAY_LOAD_REPORT
+#include "pico/stdio.h"
+#include <cstdio>
+#endif
+
+/**
+Resonator into Delay - Workshop System Computer Card
+
+The Resonator and Audio Delay cards in series on one Computer, as if Audio Out 1
+and 2 of the resonator were patched into Audio In 1 and 2 of the delay. Both cards
+run unchanged, constructed as engines, which leave the hardware to this card: it
+collects the inputs, maps the controls, runs each engine's ProcessSample through
+ProcessEngineSample, and sends the delay's CV and pulse outputs to its own.
+
+The resonator runs on core 1, one sample ahead of the delay on core 0. Each audio
+interrupt passes the resonator this sample's inputs through the inter-core FIFO,
+then runs the delay on the resonator's output from the previous sample while
+core 1 works. Built with RESODELAY_ONE_CORE, both run in turn in the audio
+interrupt instead, and the interrupt load drops the resonator's upper strings
+and the delay's separate right tap when they don't fit.
+*/
+
+class ResoDelay : public ComputerCardT<ResoDelay>
+{
+    friend ComputerCardT;
+
+    ResonatingStrings strings;
+    AudioDelay delay;
+
+    // Resonator inputs, double-buffered: core 0 fills one while core 1 may still be
+    // reading the other. Outputs are written by core 1, read by core 0 between samples.
+    TraceInputs stringsIn[2];
+    uint32_t stringsBuffer;
+    int16_t stringsOut[2];
+    int32_t stringsCV[2];    // the resonator sets no CV or pulse outputs
+    bool stringsPulse[2];
+    TraceInputs delayIn;
+
+    // Control pages: with the switch up the knobs set the delay, otherwise the
+    // resonator. After a page change, each knob picks up its parameter once it
+    // reaches the parameter's value, so that nothing jumps.
+    enum Page { STRINGS = 0, DELAY = 1 };
+    Page page;
+    int32_t pageKnobs[2][3];
+    bool knobLive[3];
+    static const int32_t PICKUP_RANGE = 48;
+
+    // Switch down: a short press steps the chord mode, holding it steps the delay mode.
+    // The count starts past a long press, as if the switch were already held, so that
+    // the switch filter settling through Down at power-on isn't taken for a press.
+    static const uint32_t LONG_PRESS_SAMPLES = 24000;  // 0.5s
+    uint32_t downSamples;
+
+#ifndef RESODELAY_ONE_CORE
+    static inline ResoDelay *core1Card;
+
+    static void __not_in_flash_func(Core1Main)() {
+        ResoDelay *card = core1Card;
+        ConfigureInterpolators();  // InterpDelayLine uses this core's INTERP0
+
+        // No resonator output yet for the first sample
+        multicore_fifo_push_blocking(0);
+        while (true) {
+            uint32_t buffer = multicore_fifo_pop_blocking();
+            __dmb();
+            card->strings.ProcessEngineSample(card->stringsIn[buffer], card->stringsOut, card->stringsCV, card->stringsPulse);
+            __dmb();
+            multicore_fifo_push_blocking(buffer);
+        }
+    }
+#endif
+
+#ifdef RESODELAY_LOAD_REPORT
+    static void ReportLoad(void *context, uint32_t) {
+        ResoDelay *card = (ResoDelay *)context;
+        static const char *qualityNames[] = {"full", "reduced", "minimal"};
+        printf("ISR load %3lu%%, quality %s\n", (unsigned long)card->ISRLoad(), qualityNames[card->QualityLevel()]);
+    }
+#endif
+
+    void updateControls(Switch &stringsSwitch, Switch &delaySwitch) {
+        Switch switchPos = SwitchVal();
+
+        Page newPage = (switchPos == Up) ? DELAY : STRINGS;
+        if (newPage != page) {
+            page = newPage;
+            for (int k = 0; k < 3; k++) knobLive[k] = false;
+        }
+        for (int k = 0; k < 3; k++) {
+            int32_t knob = KnobVal((Knob)k);
+            int32_t distance = knob - pageKnobs[page][k];
+            if (distance < 0) distance = -distance;
+            if (distance < PICKUP_RANGE) knobLive[k] = true;
+            if (knobLive[k]) pageKnobs[page][k] = knob;
+        }
+
+        // Each card sees its switch down for one sample
+        stringsSwitch = Middle;
+        delaySwitch = Middle;
+        if (switchPos == Down) {
+            downSamples++;
+            if (downSamples == LONG_PRESS_SAMPLES) delaySwitch = Down;
+        } else {
+            if (downSamples > 0 && downSamples < LONG_PRESS_SAMPLES) stringsSwitch = Down;
+            downSamples = 0;
+        }
+    }
+
+public:
+    ResoDelay() : strings(Engine), delay(Engine), stringsBuffer(0), page(STRINGS), downSamples(LONG_PRESS_SAMPLES) {
+        for (int i = 0; i < 2; i++) {
+            stringsOut[i] = 0;
+            stringsCV[i] = 0;
+            stringsPulse[i] = false;
+        }
+
+        // Resonator knobs are live from the start; the delay's start at 1/3 wet,
+        // about half a second, and 40% feedback
+        for (int k = 0; k < 3; k++) {
+            pageKnobs[STRINGS][k] = 2048;
+            knobLive[k] = true;
+        }
+        pageKnobs[DELAY][Main] = 1365;
+        pageKnobs[DELAY][X] = 1000;
+        pageKnobs[DELAY][Y] = 1640;
+
+        for (int b = 0; b < 2; b++) stringsIn[b] = {};
+        delayIn = {};
+    }
+
+    void Run() {
+#ifdef RESODELAY_LOAD_REPORT
+        stdio_init_all();
+        AddBackgroundTask(ReportLoad, this, 1000000);
+#endif
+#ifndef RESODELAY_ONE_CORE
+        core1Card = this;
+        multicore_launch_core1(Core1Main);
+#endif
+        ComputerCardT::Run();
+    }
+
+protected:
+    void ProcessSample() {
+        Switch stringsSwitch, delaySwitch;
+        updateControls(stringsSwitch, delaySwitch);
+        Quality quality = QualityLevel();
+        uint32_t time = SampleTime();
+
+        // Resonator: the card's inputs, with the resonator page's knobs
+        TraceInputs &in = stringsIn[stringsBuffer];
+        for (int k = 0; k < 3; k++) in.knobs[k] = pageKnobs[STRINGS][k];
+        for (int i = 0; i < 2; i++) {
+            in.cv[i] = CVIn(i);
+            in.audio[i] = AudioIn(i);
+            in.pulse[i] = PulseIn(i);
+            in.numEdges[i] = PulseInEdges(i, in.edges[i], pulseEdgeQueueSize);
+        }
+        for (int j = 0; j < 6; j++) in.connected[j] = Connected((Input)j);
+        in.switchVal = stringsSwitch;
+        in.quality = quality;
+        in.sampleTime = time;
+
+        // Delay: the resonator's audio out, the pulse inputs (tap tempo, freeze), no CV
+        for (int k = 0; k < 3; k++) delayIn.knobs[k] = pageKnobs[DELAY][k];
+        for (int i = 0; i < 2; i++) {
+            delayIn.cv[i] = 0;
+            delayIn.pulse[i] = in.pulse[i];
+            delayIn.numEdges[i] = in.numEdges[i];
+            for (int e = 0; e < in.numEdges[i]; e++) delayIn.edges[i][e] = in.edges[i][e];
+        }
+        delayIn.connected[Audio1] = true;
+        delayIn.connected[Audio2] = true;
+        delayIn.connected[CV1] = false;
+        delayIn.connected[CV2] = false;
+        delayIn.connected[Pulse1] = in.connected[Pulse1];
+        delayIn.connected[Pulse2] = in.connected[Pulse2];
+        delayIn.switchVal = delaySwitch;
+        delayIn.quality = quality;
+        delayIn.sampleTime = time;
+
+#ifdef RESODELAY_ONE_CORE
+        strings.ProcessEngineSample(in, stringsOut, stringsCV, stringsPulse);
+        delayIn.audio[0] = stringsOut[0];
+        delayIn.audio[1] = stringsOut[1];
+#else
+        // Collect the previous sample from core 1, and start this one
+        multicore_fifo_pop_blocking();
+        __dmb();
+        delayIn.audio[0] = stringsOut[0];
+        delayIn.audio[1] = stringsOut[1];
+        __dmb();
+        multicore_fifo_push_blocking(stringsBuffer);
+        stringsBuffer ^= 1;
+#endif
+
+        int16_t audioOut[2];
+        int32_t cvOut[2];
+        bool pulseOut[2];
+        delay.ProcessEngineSample(delayIn, audioOut, cvOut, pulseOut);
+        AudioOut1(audioOut[0]);
+        AudioOut2(audioOut[1]);
+        for (int i = 0; i < 2; i++) {
+            CVOutPrecise(i, cvOut[i]);
+            PulseOut(i, pulseOut[i]);
+        }
+
+        // LEDs: those of the card whose page is selected
+        const ComputerCard &shown = (page == DELAY) ? (const ComputerCard &)delay : (const ComputerCard &)strings;
+        for (int i = 0; i < 6; i++) LedOn(i, shown.ReplayLedLevel(i) != 0);
+    }
+};
+
+#endif
@@ -0,0 +1,11 @@
+#include "ResoDelay.h"
+
+int main() {
+    static ResoDelay resodelay;
+    resodelay.EnableNormalisationProbe();
+    resodelay.EnablePulseInEdgeCapture();
+    resodelay.EnableAudioRateCV();
+    resodelay.SetCVSmoothing(1);  // as the resonator, for pitch FM
+    resodelay.Run();
+    return 0;
+}
@@ -0,0 +1,404 @@
+#ifndef RESONATINGSTRINGS_H
+#define RESONATINGSTRINGS_H
+
+#include "ComputerCard.h"
+
+/**
+Resonator Workshop System Computer Card - by Johan Eklund
+version 0.3 - 2026-01-09
+
+Four resonating strings using Karplus-Strong synthesis
+*/
+
+// Delay lookup table for 1V/oct pitch control
+// 341 entries per octave (1V of CV), inverse exponential curve
+// Base: C1 = 32.7Hz at 48kHz = 1468 samples, scaled by 64
+// Higher input = shorter delay = higher pitch
+// delay_vals[i] = 93952 / 2^(i/341), generated at compile time
+static constexpr auto delay_vals = ExpPeriodTable<341>(93952);
+static_assert(delay_vals[0] == 93952 && delay_vals[170] == 66502 && delay_vals[340] == 47072,
+              "delay_vals differs from the table it replaced");
+
+// Exponential delay lookup for 1V/oct pitch control
+// in: 0-4095 (knob + CV combined)
+// Returns delay in samples with 8 fractional bits (right-shifted by octave)
+// Called every sample, so divides by 341 with a multiply: exact for 0-4091
+inline int32_t ExpDelay(int32_t in) {
+    if (in < 0) in = 0;
+    if (in > 4091) in = 4091;
+    int32_t oct = (in * 6151) >> 21;
+    int32_t suboct = in - oct * 341;
+    return (delay_vals[suboct] << 8) >> oct;
+}
+
+class ResonatingStrings : public ComputerCardT<ResonatingStrings>
+{
+    friend ComputerCardT;
+
+private:
+    // Fixed-point formats: sums and differences of two 12-bit samples, and
+    // damping filter coefficients. Mix gains are EqualPowerMixer::Gain.
+    using Signal = Fixed<12, 0>;
+    using Coefficient = Fixed<0, 16>;
+
+    static const int MAX_DELAY_SIZE = 1920;
+
+    InterpDelayLine<MAX_DELAY_SIZE> delayLine1;
+    InterpDelayLine<MAX_DELAY_SIZE> delayLine2;
+    InterpDelayLine<MAX_DELAY_SIZE> delayLine3;
+    InterpDelayLine<MAX_DELAY_SIZE> delayLine4;
+
+    int delayLength1;
+    int delayLength2;
+    int delayLength3;
+    int delayLength4;
+
+    int32_t filterState1;
+    int32_t filterState2;
+    int32_t filterState3;
+    int32_t filterState4;
+
+    // Chord modes
+    enum ChordMode {
+        HARMONIC = 0,    // 1:1, 2:1, 3:1, 4:1 (harmonic series)
+        FIFTH = 1,       // 1:1, 3:2, 2:1, 3:1 (stacked fifths)
+        MAJOR7 = 2,      // 1:1, 5:4, 3:2, 15:8 (major 7th chord)
+        MINOR7 = 3,      // 1:1, 6:5, 3:2, 9:5 (minor 7th chord)
+        DIM = 4,         // 1:1, 6:5, 36:25, 3:2 (diminished)
+        SUS4 = 5,        // 1:1, 4:3, 3:2, 2:1 (suspended 4th)
+        ADD9 = 6,        // 1:1, 5:4, 3:2, 9:4 (major add 9)
+        TANPURA_PA = 7,  // 1:1, 3:2, 2:1, 4:1 (Sa, Pa, Sa', Sa'')
+        TANPURA_MA = 8,  // 1:1, 4:3, 2:1, 4:1 (Sa, Ma, Sa', Sa'')
+        TANPURA_NI = 9,  // 1:1, 15:8, 2:1, 4:1 (Sa, Ni, Sa', Sa'')
+        TANPURA_NI_KOMAL = 10  // 1:1, 9:5, 2:1, 4:1 (Sa, ni, Sa', Sa'')
+    };
+    static const int NUM_MODES = 11;
+    ChordMode currentMode;
+    bool lastSwitchDown;
+
+    // String delay / fundamental delay for the current mode (Q13), updated on mode change
+    static const int RATIO_BITS = 13;
+    uint32_t delayRatio[4];
+
+    int32_t pulseExciteEnvelope;
+    uint32_t noiseState;
+
+    int32_t dcState1, dcState2, dcState3, dcState4;
+
+    // Dry/wet mix (Main knob)
+    EqualPowerMixer mixer;
+
+    // One-pole lowpass filter for damping
+    int32_t dampingFilter(int32_t input, int32_t& state, Coefficient coefficient) {
+        state += Multiply<12, 0>(Signal::FromRaw(input - state), coefficient).Raw();
+        return state;
+    }
+
+    // Process one string with linear interpolation for fractional delay
+    int32_t processString(InterpDelayLine<MAX_DELAY_SIZE>& delayLine, int delayLength,
+                         int32_t& filterState, int32_t& dcState, int32_t excitation,
+                         Coefficient dampingCoeff, int32_t frac) {
+        // Linear interpolation between two adjacent samples, based on fractional part (frac is 0-255)
+        int32_t delayedSample = delayLine.Read(delayLength, frac);
+
+        int32_t dampedSample = dampingFilter(delayedSample, filterState, dampingCoeff);
+
+        // DC blocker: remove DC offset to prevent accumulation
+        dcState += (dampedSample - dcState) >> 8;
+        dampedSample -= dcState;
+
+        // Add excitation (input signal)
+        int32_t newSample = dampedSample + excitation;
+
+        // Soft clipping to prevent overflow
+        if (newSample > 2047) newSample = 2047;
+        if (newSample < -2047) newSample = -2047;
+
+        // Write back to delay line
+        delayLine.Write((int16_t)newSample);
+
+        // Advance write index
+        delayLine.Advance();
+
+        return delayedSample;
+    }
+
+    // Calculate frequency ratio based on chord mode and string number
+    // Using fixed-point math to avoid floating-point on Cortex-M0+
+    // Returns numerator and denominator for each ratio
+    void getFrequencyRatios(int& num1, int& den1, int& num2, int& den2,
+                            int& num3, int& den3, int& num4, int& den4) {
+        // String 1: Fundamental
+        num1 = 1;
+        den1 = 1;
+
+        switch (currentMode) {
+            case HARMONIC:
+                // Harmonic series: 1:1, 2:1, 3:1, 4:1
+                num2 = 2; den2 = 1;
+                num3 = 3; den3 = 1;
+                num4 = 4; den4 = 1;
+                break;
+            case FIFTH:
+                // Stacked fifths: 1:1, 3:2, 2:1, 3:1
+                num2 = 3; den2 = 2;
+                num3 = 2; den3 = 1;
+                num4 = 3; den4 = 1;
+                break;
+            case MAJOR7:
+                // Major 7th: 1:1, 5:4, 3:2, 15:8
+                num2 = 5; den2 = 4;
+                num3 = 3; den3 = 2;
+                num4 = 15; den4 = 8;
+                break;
+            case MINOR7:
+                // Minor 7th: 1:1, 6:5, 3:2, 9:5
+                num2 = 6; den2 = 5;
+                num3 = 3; den3 = 2;
+                num4 = 9; den4 = 5;
+                break;
+            case DIM:
+                // Diminished: 1:1, 6:5, 36:25, 3:2
+                num2 = 6; den2 = 5;
+                num3 = 36; den3 = 25;
+                num4 = 3; den4 = 2;
+                break;
+            case SUS4:
+                // Suspended 4th: 1:1, 4:3, 3:2, 2:1
+                num2 = 4; den2 = 3;
+                num3 = 3; den3 = 2;
+                num4 = 2; den4 = 1;
+                break;
+            case ADD9:
+                // Major add 9: 1:1, 5:4, 3:2, 9:4
+                num2 = 5; den2 = 4;
+                num3 = 3; den3 = 2;
+                num4 = 9; den4 = 4;
+                break;
+            case TANPURA_PA:
+                // Tanpura Pa: 1:1, 3:2, 2:1, 4:1 (Sa, Pa, Sa', Sa'')
+                num2 = 3; den2 = 2;
+                num3 = 2; den3 = 1;
+                num4 = 4; den4 = 1;
+                break;
+            case TANPURA_MA:
+                // Tanpura Ma: 1:1, 4:3, 2:1, 4:1 (Sa, Ma, Sa', Sa'')
+                num2 = 4; den2 = 3;
+                num3 = 2; den3 = 1;
+                num4 = 4; den4 = 1;
+                break;
+            case TANPURA_NI:
+                // Tanpura Ni: 1:1, 15:8, 2:1, 4:1 (Sa, Ni, Sa', Sa'')
+                num2 = 15; den2 = 8;
+                num3 = 2; den3 = 1;
+                num4 = 4; den4 = 1;
+                break;
+            case TANPURA_NI_KOMAL:
+                // Tanpura ni: 1:1, 9:5, 2:1, 4:1 (Sa, ni, Sa', Sa'')
+                num2 = 9; den2 = 5;
+                num3 = 2; den3 = 1;
+                num4 = 4; den4 = 1;
+                break;
+        }
+    }
+
+    // Precompute delay ratios (den/num) for the current mode, so that
+    // string lengths need no division when pitch CV changes every sample
+    void updateDelayRatios() {
+        int num[4], den[4];
+        getFrequencyRatios(num[0], den[0], num[1], den[1], num[2], den[2], num[3], den[3]);
+        for (int i = 0; i < 4; i++) {
+            delayRatio[i] = ((den[i] << RATIO_BITS) + num[i] / 2) / num[i];
+        }
+    }
+
+public:
+    explicit ResonatingStrings(Role role = Standalone) : ComputerCardT(role),
+                          delayLength1(100), delayLength2(150), delayLength3(200), delayLength4(400),
+                          filterState1(0), filterState2(0), filterState3(0), filterState4(0),
+                          currentMode(HARMONIC), lastSwitchDown(true),
+                          pulseExciteEnvelope(0), noiseState(12345),
+                          dcState1(0), dcState2(0), dcState3(0), dcState4(0) {
+        updateDelayRatios();
+    }
+
+protected:
+    void ProcessSample() override {
+        int16_t audioIn1 = AudioIn1();
+        int16_t audioIn2 = AudioIn2();
+        int32_t audioIn = ((int32_t)audioIn1 + (int32_t)audioIn2 + 1) >> 1;
+
+        // Mode switching
+        Switch switchPos = SwitchVal();
+        bool switchDown = (switchPos == Down);
+        if (switchDown && !lastSwitchDown) {
+            currentMode = (ChordMode)((currentMode + 1) % NUM_MODES);
+            updateDelayRatios();
+        }
+        lastSwitchDown = switchDown;
+
+        // FREQUENCY CONTROL - 1V/oct
+        // CV1: ±6V maps to -2048 to 2047, sampled at 48kHz for audio-rate FM
+        int32_t pitchCV;
+
+        if (Disconnected(Input::CV1)) {
+            // No CV connected: X knob controls C1-C7 range
+            // Map knob 0-4095 to pitchCV 2048-4095 (6 octaves)
+            pitchCV = 2048 + (KnobVal(X) / 2);
+        } else {
+            // CV connected: X knob is fine tune (±1 octave)
+            // 1 octave = 341 steps
+            int32_t fineTune = ((KnobVal(X) - 2048) * 341) / 2048;
+
+            // CV input with 1V/oct scaling
+            // CVIn1 range: -2048 to +2047 for ±6V, so 1V = 341 counts
+            int32_t scaledCV = CVIn1();
+            
+            pitchCV = 2048 + scaledCV + fineTune;
+        }
+
+        if (pitchCV > 4095) pitchCV = 4095;
+        if (pitchCV < 0) pitchCV = 0;
+
+        // Get delay from exponential lookup table (1V/oct), keeping 8 fractional bits
+        // so that pitch modulation is smooth rather than stepped by whole samples
+        int32_t baseDelay = ExpDelay(pitchCV);
+
+        // Clamp to usable range
+        const int MIN_DELAY = 15;
+        const int MAX_DELAY = 1468;  // C1 at 32.7Hz
+        if (baseDelay < (MIN_DELAY << 8)) baseDelay = MIN_DELAY << 8;
+        if (baseDelay > (MAX_DELAY << 8)) baseDelay = MAX_DELAY << 8;
+
+        // Calculate delay lengths for each string using fixed-point math
+        // delay = baseDelay * denominator / numerator, with the ratio precomputed for the chord mode
+        // 8 fractional bits for interpolation; ratios are <= 1, so the product fits in 32 bits
+        int32_t delayFull1 = ((uint32_t)baseDelay * delayRatio[0]) >> RATIO_BITS;
+        int32_t delayFull2 = ((uint32_t)baseDelay * delayRatio[1]) >> RATIO_BITS;
+        int32_t delayFull3 = ((uint32_t)baseDelay * delayRatio[2]) >> RATIO_BITS;
+        int32_t delayFull4 = ((uint32_t)baseDelay * delayRatio[3]) >> RATIO_BITS;
+
+        delayLength1 = delayFull1 >> 8;  // Integer part
+        delayLength2 = delayFull2 >> 8;
+        delayLength3 = delayFull3 >> 8;
+        delayLength4 = delayFull4 >> 8;
+
+        int32_t frac1 = delayFull1 & 0xFF;  // Fractional part (0-255)
+        int32_t frac2 = delayFull2 & 0xFF;
+        int32_t frac3 = delayFull3 & 0xFF;
+        int32_t frac4 = delayFull4 & 0xFF;
+
+        // Clamp to valid range
+        if (delayLength1 < 10) delayLength1 = 10;
+        if (delayLength2 < 10) delayLength2 = 10;
+        if (delayLength3 < 10) delayLength3 = 10;
+        if (delayLength4 < 10) delayLength4 = 10;
+        if (delayLength1 > MAX_DELAY_SIZE - 1) delayLength1 = MAX_DELAY_SIZE - 1;
+        if (delayLength2 > MAX_DELAY_SIZE - 1) delayLength2 = MAX_DELAY_SIZE - 1;
+        if (delayLength3 > MAX_DELAY_SIZE - 1) delayLength3 = MAX_DELAY_SIZE - 1;
+        if (delayLength4 > MAX_DELAY_SIZE - 1) delayLength4 = MAX_DELAY_SIZE - 1;
+
+        // DAMPING CONTROL (Y Knob + CV2)
+        int32_t dampingKnob = KnobVal(Y) + CVIn2();  // 0-4095 knob + CV
+        if (dampingKnob > 4095) dampingKnob = 4095;
+        if (dampingKnob < 0) dampingKnob = 0;
+
+        // Map to filter coefficient (more damping = lower coefficient, longer decay = higher coefficient)
+        Coefficient dampingCoeff = Coefficient::FromRaw(32000 + ((dampingKnob * 33300) / 4095));
+
+        // Excitation amounts for each string
+        // String 1 gets full input, others get scaled versions (sympathetic response)
+        int32_t excitation1 = audioIn >> 2;  // Direct excitation
+        int32_t excitation2 = audioIn >> 4;  // Sympathetic response
+        int32_t excitation3 = audioIn >> 4;  // Sympathetic response
+        int32_t excitation4 = audioIn >> 3;  // 4th string
+
+        // Pulse1 triggers a noise burst to excite strings (like plucking)
+        // Captured edges catch triggers shorter than a sample
+        PulseEdge edges[4];
+        int numEdges = PulseInEdges(0, edges, 4);
+        for (int i = 0; i < numEdges; i++) {
+            if (edges[i].rising) {
+                pulseExciteEnvelope = 2048;  // Start excitation envelope
+            }
+        }
+
+        // Apply decaying noise burst while envelope is active
+        if (pulseExciteEnvelope > 10) {
+            noiseState = noiseState * 1103515245 + 12345;
+            int32_t noise = (int32_t)((noiseState >> 16) & 0xFFF) - 2048;
+            int32_t scaledNoise = (noise * pulseExciteEnvelope) >> 11;
+            excitation1 += scaledNoise;
+            excitation2 += scaledNoise >> 1;
+            excitation3 += scaledNoise >> 1;
+            excitation4 += scaledNoise >> 1;
+            // Fast decay for short pluck burst
+            pulseExciteEnvelope = (pulseExciteEnvelope * 250) >> 8;
+        }
+
+        // Process each string with fractional delay interpolation
+        // If the framework reports high interrupt load, drop the upper strings until it recovers
+        Quality quality = QualityLevel();
+        int32_t out1 = processString(delayLine1, delayLength1,
+                                     filterState1, dcState1, excitation1, dampingCoeff, frac1);
+        int32_t out2 = processString(delayLine2, delayLength2,
+                                     filterState2, dcState2, excitation2, dampingCoeff, frac2);
+        int32_t out3 = 0, out4 = 0;
+        if (quality != Minimal) {
+            out3 = processString(delayLine3, delayLength3,
+                                 filterState3, dcState3, excitation3, dampingCoeff, frac3);
+        }
+        if (quality == Full) {
+            out4 = processString(delayLine4, delayLength4,
+                                 filterState4, dcState4, excitation4, dampingCoeff, frac4);
+        }
+
+        // Mix strings together - stereo mid/side
+        // Out1 (mid): all strings summed - mono compatible
+        // Out2 (side): strings 1&3 center, strings 2&4 wide/diffuse
+        int32_t resonatorOut1, resonatorOut2;
+        if (SwitchVal() == Switch::Up) {
+            // TUNING MODE: first string only
+            resonatorOut1 = out1 / 2;
+            resonatorOut2 = out1 / 2;
+        } else {
+            resonatorOut1 = (out1 + out2 + out3 + out4) / 4;
+            resonatorOut2 = (out1 - out2 + out3 - out4) / 4;
+        }
+
+        resonatorOut1 *= 2;
+        resonatorOut2 *= 2;
+
+        // WET/DRY MIX (Main Knob)
+        mixer.SetMix(KnobVal(Main));  // 0-4095
+
+        Fixed<13, 0> mixed1, mixed2;
+        mixer.Mix(Signal::FromRaw(audioIn), Signal::FromRaw(resonatorOut1), Signal::FromRaw(resonatorOut2), mixed1, mixed2);
+        int32_t mixedOutput1 = mixed1.Raw();
+        int32_t mixedOutput2 = mixed2.Raw();
+
+        // Clipping
+        if (mixedOutput1 > 2047) mixedOutput1 = 2047;
+        if (mixedOutput1 < -2047) mixedOutput1 = -2047;
+        if (mixedOutput2 > 2047) mixedOutput2 = 2047;
+        if (mixedOutput2 < -2047) mixedOutput2 = -2047;
+
+        // Stereo output
+        AudioOut1((int16_t)mixedOutput1);
+        AudioOut2((int16_t)mixedOutput2);
+
+        // LED indicators - all 6 LEDs show chord mode
+        // LED 0: HARMONIC, LED 1: FIFTH, LED 2: MAJOR7
+        // LED 3: MINOR7, LED 4: DIM, LED 5: SUS4
+        // ADD9 (mode 6): LEDs 0+5, TANPURA_PA (mode 7): LEDs 1+4, TANPURA_MA (mode 8): LEDs 2+3
+        // TANPURA_NI (mode 9): LEDs 0+3, TANPURA_NI_KOMAL (mode 10): LEDs 2+5
+        LedOn(0, currentMode == HARMONIC || currentMode == ADD9 || currentMode == TANPURA_NI);
+        LedOn(1, currentMode == FIFTH || currentMode == TANPURA_PA);
+        LedOn(2, currentMode == MAJOR7 || currentMode == TANPURA_MA || currentMode == TANPURA_NI_KOMAL);
+        LedOn(3, currentMode == MINOR7 || currentMode == TANPURA_MA || currentMode == TANPURA_NI);
+        LedOn(4, currentMode == DIM || currentMode == TANPURA_PA);
+        LedOn(5, currentMode == SUS4 || currentMode == ADD9 || currentMode == TANPURA_NI_KOMAL);
+    }
+};
+
+#endif
@@ -0,0 +1,244 @@
+#ifndef FDNREVERB_H
+#define FDNREVERB_H
+
+#include "ComputerCard.h"
+
+/**
+FDN Reverb - Workshop System Computer Card
+
+A feedback delay network: four delay lines whose outputs are damped, scaled
+for the decay time, mixed by a 4x4 Hadamard matrix and fed back into the lines.
+The Hadamard matrix needs only adds and subtracts; its scale of 1/2 is folded
+into the decay gain, so the mixing itself is exact. Each line's length is
+swept by a few samples by an LFO, so that the tail's modes drift rather than
+ring. Short allpass chains on each input build echo density before the network.
+*/
+
+class FdnReverb : public ComputerCardT<FdnReverb>
+{
+    friend ComputerCardT;
+
+private:
+    static const int LINES = 4;
+
+    // Line buffers, room for the largest size plus the sweep
+    static const int LINE_SIZE = 8192;  // 170ms
+
+    // Room sizes (switch down steps through them): line lengths in samples,
+    // primes in the ratios 1 : 1.19 : 1.41 : 1.68, so that no two lines' echoes
+    // coincide
+    enum RoomSize { ROOM = 0, HALL = 1, CATHEDRAL = 2, NUM_SIZES = 3 };
+    static constexpr int32_t lineLengths[NUM_SIZES][LINES] = {
+        {TableMath::NextPrime(1000), TableMath::NextPrime(1190), TableMath::NextPrime(1410), TableMath::NextPrime(1680)},
+        {TableMath::NextPrime(2000), TableMath::NextPrime(2380), TableMath::NextPrime(2820), TableMath::NextPrime(3360)},
+        {TableMath::NextPrime(3400), TableMath::NextPrime(4046), TableMath::NextPrime(4794), TableMath::NextPrime(5712)},
+    };
+
+    // Length sweep: +-8 samples at 0.6Hz, the lines a quarter cycle apart.
+    // After a size change, lengths glide to the new size at 1/16 sample per
+    // sample, rather than jumping.
+    static const int32_t SWEEP_SHIFT = 4;  // LFO (+-32767) << 4 is +-8 samples, Q16
+    static const int32_t LENGTH_GLIDE = 4096;  // Q16
+
+    // Decay time (X knob): 0.3s to 30s in DECAY_STEPS steps, exponentially.
+    // Each line's gain, Q15, is the fall over its length for a 60dB decay in
+    // that time, so all four lines decay alike: gain = 10^(-3 * length / (T * 48000)).
+    static const int DECAY_STEPS = 64;
+    static constexpr auto decayGains = MakeTable<int32_t, NUM_SIZES * LINES * (DECAY_STEPS + 1)>([](int i) {
+        int step = i % (DECAY_STEPS + 1);
+        int line = (i / (DECAY_STEPS + 1)) % LINES;
+        int size = i / ((DECAY_STEPS + 1) * LINES);
+        double seconds = 0.3 * TableMath::Exp2(step * 6.644 / DECAY_STEPS);
+        return TableMath::Round(32768 * TableMath::Exp2(-9.966 * lineLengths[size][line] / (seconds * 48000)));
+    });
+
+    // Damping (Y knob): one-pole lowpass in each line, coefficient Q15, from
+    // 16kHz down to 1kHz. b = 1 - e^(-2 pi f / 48000)
+    static constexpr auto dampingCoefficients = MakeTable<int32_t, 257>([](int i) {
+        double hz = 16000 / TableMath::Exp2(i * 4.0 / 256);
+        return TableMath::Round(32768 * (1 - TableMath::Exp(-2 * TableMath::pi * hz / 48000)));
+    });
+
+    // Input diffusion, a chain per channel: prime lengths from about 1.5ms to
+    // 8ms, different on each side
+    static constexpr int32_t diffuserLengthsLeft[4] = {
+        TableMath::NextPrime(71), TableMath::NextPrime(149), TableMath::NextPrime(241), TableMath::NextPrime(383)
+    };
+    static constexpr int32_t diffuserLengthsRight[4] = {
+        TableMath::NextPrime(83), TableMath::NextPrime(163), TableMath::NextPrime(263), TableMath::NextPrime(397)
+    };
+    static const int32_t DIFFUSION = 2560;  // allpass gain, 0.625
+
+    // Samples in the lines carry 2 extra fractional bits, as in AllpassChain
+    InterpDelayLine<LINE_SIZE> lines[LINES];
+    int16_t diffuserStorage[AllpassChain<4>::StorageSize(diffuserLengthsLeft) +
+                            AllpassChain<4>::StorageSize(diffuserLengthsRight)];
+    AllpassChain<4> diffuserLeft;
+    AllpassChain<4> diffuserRight;
+
+    RoomSize roomSize;
+    int32_t lengthFine[LINES];  // current lengths, samples Q16, gliding to the size's
+    Lfo lfo;
+
+    int32_t gains[LINES];       // Q15
+    int32_t dampingCoef;        // Q15
+    int32_t decaySetting;
+    int32_t dampingSetting;
+
+    // Filter states
+    int32_t dampState[LINES];
+    int32_t hpfStateLeft;   // Q10
+    int32_t hpfStateRight;  // Q10
+
+    // Freeze (switch up, or Pulse In 2): no damping, a gain of all but 1, and
+    // the input faded out over 4096 samples, so that the tail holds
+    static const int32_t FREEZE_GAIN = 32767;  // Q15
+    int32_t inputLevel;  // 0-4095
+    bool lastSwitchDown;
+
+    EqualPowerMixer mixer;
+
+    // One-pole highpass, as AudioDelay's, keeping DC out of the loop, where the
+    // longest decays would raise it a hundredfold. The state carries 10
+    // fractional bits: a step rounds to nothing once the state is within 164
+    // of the input, so in whole samples it would let up to 164 through, and at
+    // 8 fractional bits still one.
+    int32_t highpass(int32_t input, int32_t &state) {
+        state += (((input << 10) - state) * 200 + 32768) >> 16;
+        return input - ((state + 512) >> 10);
+    }
+
+    void setDecay(int32_t setting) {
+        if (setting == decaySetting) return;
+        decaySetting = setting;
+
+        int32_t step = setting >> 6;
+        int32_t frac = setting & 63;
+        for (int i = 0; i < LINES; i++) {
+            const int32_t *g = &decayGains[(roomSize * LINES + i) * (DECAY_STEPS + 1) + step];
+            gains[i] = g[0] + (((g[1] - g[0]) * frac + 32) >> 6);
+        }
+    }
+
+    void setDamping(int32_t setting) {
+        if (setting == dampingSetting) return;
+        dampingSetting = setting;
+        dampingCoef = dampingCoefficients[setting >> 4];
+    }
+
+    static int32_t clamp(int32_t value, int32_t limit) {
+        if (value > limit) return limit;
+        if (value < -limit) return -limit;
+        return value;
+    }
+
+public:
+    FdnReverb()
+        : diffuserLeft(diffuserStorage, diffuserLengthsLeft, DIFFUSION),
+          diffuserRight(diffuserStorage + AllpassChain<4>::StorageSize(diffuserLengthsLeft), diffuserLengthsRight, DIFFUSION),
+          roomSize(HALL), dampingCoef(0), decaySetting(-1), dampingSetting(-1),
+          hpfStateLeft(0), hpfStateRight(0), inputLevel(4095), lastSwitchDown(true) {
+        diffuserLeft.Clear();
+        diffuserRight.Clear();
+        for (int i = 0; i < LINES; i++) {
+            lengthFine[i] = lineLengths[roomSize][i] << 16;
+            gains[i] = 0;
+            dampState[i] = 0;
+        }
+        lfo.SetIncrement(Lfo::Increment(0.6));
+    }
+
+protected:
+    void ProcessSample() {
+        // Switch down: next room size. The decay gains follow at once; the
+        // lengths glide.
+        Switch switchPos = SwitchVal();
+        bool switchDown = (switchPos == Down);
+        if (switchDown && !lastSwitchDown) {
+            roomSize = (RoomSize)((roomSize + 1) % NUM_SIZES);
+            decaySetting = -1;
+        }
+        lastSwitchDown = switchDown;
+
+        int32_t decay = KnobVal(X) + CVIn1();
+        if (decay > 4095) decay = 4095;
+        if (decay < 0) decay = 0;
+        setDecay(decay);
+
+        int32_t damping = KnobVal(Y) + CVIn2();
+        if (damping > 4095) damping = 4095;
+        if (damping < 0) damping = 0;
+        setDamping(damping);
+
+        mixer.SetMix(KnobVal(Main));
+
+        bool freeze = (switchPos == Up) || PulseIn2();
+        if (freeze) {
+            if (inputLevel > 0) inputLevel--;
+        } else {
+            if (inputLevel < 4095) inputLevel++;
+        }
+        // Frozen, the lowpass passes everything
+        int32_t coef = freeze ? 32768 : dampingCoef;
+
+        // Inputs: a mono source on Audio In 1 feeds both sides
+        int32_t dryLeft = AudioIn1();
+        int32_t dryRight = Connected(Audio2) ? AudioIn2() : dryLeft;
+        int32_t inLeft = diffuserLeft.Process((highpass(dryLeft, hpfStateLeft) * inputLevel + 2048) >> 12);
+        int32_t inRight = diffuserRight.Process((highpass(dryRight, hpfStateRight) * inputLevel + 2048) >> 12);
+
+        // Read the lines at their swept lengths, damp them, and scale them for
+        // the decay and the Hadamard matrix's 1/2 (Q15 gain, so >> 16). Lines
+        // are at most 16 bits and gains below 32768, so the products fit in 32.
+        int32_t out[LINES];
+        int32_t scaled[LINES];
+        for (int i = 0; i < LINES; i++) {
+            int32_t target = lineLengths[roomSize][i] << 16;
+            if (lengthFine[i] < target - LENGTH_GLIDE) lengthFine[i] += LENGTH_GLIDE;
+            else if (lengthFine[i] > target + LENGTH_GLIDE) lengthFine[i] -= LENGTH_GLIDE;
+            else lengthFine[i] = target;
+
+            int32_t delay = lengthFine[i] + (lfo.Sine((uint32_t)i << 30) << SWEEP_SHIFT);
+            out[i] = lines[i].ReadAtFine(lines[i].WriteIndex() - (delay >> 16), delay & 0xFFFF);
+
+            dampState[i] += ((out[i] - dampState[i]) * coef + 16384) >> 15;
+            int32_t gain = freeze ? FREEZE_GAIN : gains[i];
+            scaled[i] = (dampState[i] * gain + 32768) >> 16;
+        }
+        lfo.Step();
+
+        // Hadamard mixing: adds and subtracts only
+        int32_t sum01 = scaled[0] + scaled[1];
+        int32_t diff01 = scaled[0] - scaled[1];
+        int32_t sum23 = scaled[2] + scaled[3];
+        int32_t diff23 = scaled[2] - scaled[3];
+        int32_t feedback[LINES] = {sum01 + sum23, diff01 + diff23, sum01 - sum23, diff01 - diff23};
+
+        // Each side feeds two lines at half level (inputs are 12-bit, lines Q2)
+        feedback[0] += inLeft << 1;
+        feedback[2] += inLeft << 1;
+        feedback[1] += inRight << 1;
+        feedback[3] += inRight << 1;
+        for (int i = 0; i < LINES; i++) {
+            lines[i].Write((int16_t)clamp(feedback[i], 32767));
+            lines[i].Advance();
+        }
+
+        // Outputs: each side from the two lines it feeds, back to 12 bits
+        int32_t wetLeft = clamp((out[0] + out[2] + 4) >> 3, 2047);
+        int32_t wetRight = clamp((out[1] + out[3] + 4) >> 3, 2047);
+        using Sample = Fixed<11, 0>;
+        AudioOut1((int16_t)clamp(mixer.Mix(Sample::FromRaw(dryLeft), Sample::FromRaw(wetLeft)).Raw(), 2047));
+        AudioOut2((int16_t)clamp(mixer.Mix(Sample::FromRaw(dryRight), Sample::FromRaw(wetRight)).Raw(), 2047));
+
+        // LEDs: wet level on the top row, the room size below, and freeze
+        LedBrightness(0, wetLeft < 0 ? -wetLeft * 2 : wetLeft * 2);
+        LedBrightness(1, wetRight < 0 ? -wetRight * 2 : wetRight * 2);
+        LedOn(2, roomSize == ROOM);
+        LedOn(3, roomSize == HALL);
+        LedOn(4, roomSize == CATHEDRAL);
+        LedOn(5, freeze);
+    }
+};
+
+#endif
@@ -0,0 +1,8 @@
+#include "FdnReverb.h"
+
+int main() {
+    static FdnReverb reverb;
+    reverb.EnableNormalisationProbe();
+    reverb.Run();
+    return 0;
+}
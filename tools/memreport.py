@@ -0,0 +1,151 @@
+#!/usr/bin/env python3
+"""
+Memory report for Workshop System Computer cards
+
+Reports flash and RAM use of a card firmware ELF, per section and per
+symbol, the SRAM left over for heap, and per-function stack frames from
+-fstack-usage (.su) files. Exits with an error if static RAM or flash
+use is over budget, so that it can run as a post-build step.
+
+Usage:
+    memreport.py --elf card.elf [--su-dir DIR] [--ram-budget BYTES]
+                 [--flash-budget BYTES] [--nm NM] [--readelf READELF]
+"""
+
+import argparse
+import os
+import re
+import subprocess
+import sys
+
+FLASH_BASE = 0x10000000
+FLASH_END = 0x11000000
+SRAM_BASE = 0x20000000
+SRAM_END = 0x20042000  # 256KB striped main SRAM, then 4KB scratch X and 4KB scratch Y
+
+# Sections that are reservations rather than static data
+RESERVED_SECTIONS = {'.heap', '.stack_dummy', '.stack1_dummy'}
+
+# Functions that run in the audio interrupt
+ISR_FUNCTION = re.compile(r'AudioCallback|BufferFull|CollectInputs|SendOutputs|'
+                          r'UpdateCVOutputs|ProcessSample|CVMuxCallback|PulseEdgeIRQ')
+
+NUM_TOP_SYMBOLS = 12
+
+
+def run(cmd):
+    return subprocess.run(cmd, check=True, capture_output=True, text=True).stdout
+
+
+def read_sections(readelf, elf):
+    """(name, address, size) of allocated sections"""
+    sections = []
+    for line in run([readelf, '-S', '-W', elf]).splitlines():
+        m = re.match(r'\s*\[\s*\d+\]\s+(\S+)\s+\S+\s+([0-9a-f]+)\s+[0-9a-f]+\s+([0-9a-f]+)\s+\S+\s+(\S*)', line)
+        if m and 'A' in m.group(4):
+            sections.append((m.group(1), int(m.group(2), 16), int(m.group(3), 16)))
+    return sections
+
+
+def read_symbols(nm, elf):
+    """(name, address, size) of sized symbols, and {name: address} of all symbols"""
+    sized, addresses = [], {}
+    for line in run([nm, '-S', '-C', elf]).splitlines():
+        parts = line.split(None, 3)
+        if len(parts) == 4 and re.fullmatch(r'[0-9a-f]+', parts[1]):
+            sized.append((parts[3], int(parts[0], 16), int(parts[1], 16)))
+        elif len(parts) == 3:
+            addresses[parts[2]] = int(parts[0], 16)
+    # Constructor and function aliases appear more than once
+    return sorted(set(sized), key=lambda s: -s[2]), addresses
+
+
+def read_stack_usage(su_dir):
+    """(function, bytes, qualifier) from all .su files under su_dir"""
+    frames = []
+    for root, _, files in os.walk(su_dir):
+        for f in files:
+            if not f.endswith('.su'):
+                continue
+            with open(os.path.join(root, f)) as su:
+                for line in su:
+                    fields = line.rstrip('\n').split('\t')
+                    if len(fields) == 3:
+                        function = fields[0].split(':')[-1]
+                        frames.append((function, int(fields[1]), fields[2]))
+    return sorted(frames, key=lambda f: -f[1])
+
+
+def in_flash(address):
+    return FLASH_BASE <= address < FLASH_END
+
+
+def in_sram(address):
+    return SRAM_BASE <= address < SRAM_END
+
+
+def print_symbols(title, symbols):
+    print(title)
+    for name, _, size in symbols[:NUM_TOP_SYMBOLS]:
+        print(f'  {size:8d}  {name}')
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument('--elf', required=True)
+    parser.add_argument('--su-dir', help='directory searched for -fstack-usage .su files')
+    parser.add_argument('--ram-budget', type=int, help='maximum static RAM, bytes')
+    parser.add_argument('--flash-budget', type=int, help='maximum flash, bytes')
+    parser.add_argument('--nm', default='arm-none-eabi-nm')
+    parser.add_argument('--readelf', default='arm-none-eabi-readelf')
+    args = parser.parse_args()
+
+    sections = read_sections(args.readelf, args.elf)
+    symbols, addresses = read_symbols(args.nm, args.elf)
+
+    flash_used = addresses.get('__flash_binary_end', FLASH_BASE) - FLASH_BASE
+    static_ram = sum(size for name, address, size in sections
+                     if in_sram(address) and name not in RESERVED_SECTIONS)
+    heap_free = addresses.get('__HeapLimit', 0) - addresses.get('__end__', 0)
+    stack_size = addresses.get('__StackTop', 0) - addresses.get('__StackBottom', 0)
+
+    card = os.path.splitext(os.path.basename(args.elf))[0]
+    print(f'==== Memory report: {card} ====')
+    print(f'Flash:        {flash_used:8d} bytes')
+    print(f'Static RAM:   {static_ram:8d} bytes of {SRAM_END - SRAM_BASE}')
+    for name, address, size in sections:
+        if in_sram(address) and size and name not in RESERVED_SECTIONS:
+            print(f'  {name:20s} {size:8d}')
+    print(f'Core 0 stack: {stack_size:8d} bytes reserved (scratch Y)')
+    print(f'Free SRAM:    {heap_free:8d} bytes (heap, up to __HeapLimit)')
+    print()
+
+    print_symbols('Largest RAM symbols:', [s for s in symbols if in_sram(s[1])])
+    print_symbols('Largest flash symbols:', [s for s in symbols if in_flash(s[1])])
+
+    if args.su_dir:
+        frames = read_stack_usage(args.su_dir)
+        print()
+        print('Largest stack frames (-fstack-usage):')
+        for function, size, qualifier in frames[:NUM_TOP_SYMBOLS]:
+            print(f'  {size:8d}  {function} ({qualifier})')
+        isr = [f for f in frames if ISR_FUNCTION.search(f[0])]
+        if isr:
+            # No call graph: summing the audio interrupt frames, plus the 32-byte exception frame, is an upper bound
+            # for the audio path, but not for any functions it calls. See StackHighWater() for a measurement.
+            print(f'Audio interrupt frames: {sum(f[1] for f in isr) + 32} bytes, including exception entry')
+            for function, size, qualifier in isr:
+                print(f'  {size:8d}  {function} ({qualifier})')
+
+    failed = False
+    if args.ram_budget is not None and static_ram > args.ram_budget:
+        print(f'ERROR: static RAM {static_ram} bytes is over budget of {args.ram_budget}', file=sys.stderr)
+        failed = True
+    if args.flash_budget is not None and flash_used > args.flash_budget:
+        print(f'ERROR: flash {flash_used} bytes is over budget of {args.flash_budget}', file=sys.stderr)
+        failed = True
+    return 1 if failed else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())